@@ -42,6 +42,7 @@
 #include <kern/wait.h>
 #include <proc.h>
 #include <synch.h>
+#include <counters.h>
 
 
 /* in exception-*.S */
@@ -111,106 +112,20 @@ kill_curthread(vaddr_t epc, unsigned code, vaddr_t vaddr)
 		break;
 	}
 
+	kprintf("Fatal user mode trap %u sig %d (%s, epc 0x%x, vaddr 0x%x)\n",
+		code, sig, trapcodenames[code], epc, vaddr);
+
+	/* Same logic as exit, with the signal as the exit status */
 	if (sig == SIGSEGV) {
 		/* If segmentation fault (core file generated), call _MKWAIT_CORE */
-		curproc->p_exit_status = _MKWAIT_CORE(sig);
+		proc_exit(_MKWAIT_CORE(sig));
 	}
 	else {
 		/* Otherwise call _MKWAIT_SIG */
-		curproc->p_exit_status = _MKWAIT_SIG(sig);
+		proc_exit(_MKWAIT_SIG(sig));
 	}
 
-
-	kprintf("Fatal user mode trap %u sig %d (%s, epc 0x%x, vaddr 0x%x)\n",
-		code, sig, trapcodenames[code], epc, vaddr);
-
-
-	/* Same logic of exit added here for signal exit code */
-
-	/* 
-     * Check if parent has exited 
-     * If parent has exited, then can deallocate this process
-     * If parent has not exited, then should not deallocate
-     */
-    struct proc *parent_process = curproc->p_parent_process;
-
-    lock_acquire(curproc->p_parent_lock);
-
-    /* Deallocate any of my children that have completed running */
-    int num_children_tracked = array_num(curproc->p_child_process_arr);
-    for (int i = 0; i < num_children_tracked; i++) {
-        struct proc *cur_child = array_get(curproc->p_child_process_arr, i);
-        int num_elements = num_children_tracked;
-
-        /* Check if this child has completed running */
-        if (cur_child->p_is_zombie == 1) {
-            /* Deallocate the child since it has finished */
-            proc_destroy(cur_child);
-
-            /* Remove from the array and shift everything else */
-            array_remove(curproc->p_child_process_arr, i);
-
-            /* Update other children indices using new array size */
-            num_elements = array_num(curproc->p_child_process_arr);
-            for (int j = i; j < num_elements; j++) {
-                struct proc *update_child = array_get(curproc->p_child_process_arr, j);
-
-                /* Update the p_child_index since the remove shifts the array */
-                update_child->p_child_index -= 1;
-            }
-
-            /* Dont need to change any other parameters as these are set when the child process exited */
-        }
-
-        if (num_elements != num_children_tracked) {
-            i -= 1; // will get incremented again.
-            num_children_tracked = num_elements;
-        }
-
-        /* If the child has not completed running, continue to next process */
-    }
-
-
-    /* Atomically check my parent has exited */
-    lock_acquire(parent_process->p_parent_lock);
-    if (parent_process->p_is_zombie == 1) {
-        /* Parent has exited */
-        curproc->p_is_zombie = 1;
-
-        /* Exit status already set */
-
-        /* Other fields for parent don't need to be changed since it has already exited */
-
-        lock_release(parent_process->p_parent_lock);
-        lock_release(curproc->p_parent_lock);
-        proc_destroy(curproc);
-        thread_exit();
-
-        /* Should not return */
-    }
-
-    /* Parent has not exited - Cannot deallocate process */
-    parent_process->p_num_children_running -= 1;
-
-    /* Exit status already set */
-
-    /* 
-     * Set myself to be a zombie 
-     * Tells parent that I am finished running, but not deallocated, 
-     * so it must reap and deallocate me when it exits.
-     */
-    curproc->p_is_zombie = 1;
-
-    /* Broadcast */
-    cv_broadcast(parent_process->p_parent_cv, parent_process->p_parent_lock);
-   
-    /* Release lock at very end to ensure atomicity */
-    lock_release(parent_process->p_parent_lock);
-    lock_release(curproc->p_parent_lock);
-
-    thread_exit();
-
-    /* Should not return */
+	/* Should not return */
 }
 
 /*
@@ -281,6 +196,7 @@ mips_trap(struct trapframe *tf)
 			doadjust = false;
 		}
 
+		counter_inc(CTR_INTERRUPT);
 		mainbus_interrupt(tf);
 
 		if (doadjust) {
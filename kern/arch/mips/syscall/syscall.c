@@ -34,8 +34,11 @@
 #include <mips/trapframe.h>
 #include <thread.h>
 #include <current.h>
+#include <proc.h>
 #include <syscall.h>
 #include <copyinout.h>
+#include <counters.h>
+#include <trace.h>
 
 /*
  * System call dispatcher.
@@ -87,6 +90,8 @@ syscall(struct trapframe *tf)
 	KASSERT(curthread->t_iplhigh_count == 0);
 
 	callno = tf->tf_v0;
+	counter_syscall(callno);
+	TRACE(TRACE_SYSCALL, callno, curproc->p_process_id, 0);
 
 	/*
 	 * Initialize retval to 0. Many of the system calls don't
@@ -101,6 +106,8 @@ syscall(struct trapframe *tf)
 	int lseek_whence;
 	off_t lseek_offset;
 	int32_t lower_32_ret;
+	size_t copy_len;
+	unsigned copy_flags;
 
 	switch (callno) {
 	    case SYS_reboot:
@@ -134,6 +141,42 @@ syscall(struct trapframe *tf)
 			}
 			break;
 
+		case SYS_readv:
+			err = sys_readv((int)tf->tf_a0, (const_userptr_t)tf->tf_a1, (int)tf->tf_a2, &retval);
+			break;
+
+		case SYS_writev:
+			err = sys_writev((int)tf->tf_a0, (const_userptr_t)tf->tf_a1, (int)tf->tf_a2, &retval);
+			break;
+
+		case SYS_pread:
+			/* 64-bit offset needs an aligned register pair, so a3 is skipped and it lands on the stack */
+			err = copyin((userptr_t) (tf->tf_sp + 16), &lseek_offset, sizeof(off_t));
+			if (err == 0) {
+				err = sys_pread((int)tf->tf_a0, (void *)tf->tf_a1, (size_t)tf->tf_a2, lseek_offset, &retval);
+			}
+			break;
+
+		case SYS_pwrite:
+			err = copyin((userptr_t) (tf->tf_sp + 16), &lseek_offset, sizeof(off_t));
+			if (err == 0) {
+				err = sys_pwrite((int)tf->tf_a0, (const void *)tf->tf_a1, (size_t)tf->tf_a2, lseek_offset, &retval);
+			}
+			break;
+
+		case SYS_copy_file_range:
+			/* len and flags are the fifth and sixth arguments, so they're on the stack */
+			err = copyin((userptr_t) (tf->tf_sp + 16), &copy_len, sizeof(size_t));
+			if (err == 0) {
+				err = copyin((userptr_t) (tf->tf_sp + 20), &copy_flags, sizeof(unsigned));
+			}
+			if (err == 0) {
+				err = sys_copy_file_range((int)tf->tf_a0, (userptr_t)tf->tf_a1,
+							  (int)tf->tf_a2, (userptr_t)tf->tf_a3,
+							  copy_len, copy_flags, &retval);
+			}
+			break;
+
 		case SYS_close:
 			err = sys_close((int)tf->tf_a0);
 			break;
@@ -142,6 +185,10 @@ syscall(struct trapframe *tf)
 			err = sys_dup2((int)tf->tf_a0, (int)tf->tf_a1, &retval);
 			break;
 
+		case SYS_pipe:
+			err = sys_pipe((userptr_t)tf->tf_a0);
+			break;
+
 		case SYS_chdir:
 			err = sys_chdir((const char *)tf->tf_a0);
 			break;
@@ -174,12 +221,37 @@ syscall(struct trapframe *tf)
 			err = sys_sbrk((ssize_t)tf->tf_a0, &retval);
 			break;
 
+		case SYS_setpriority:
+			err = sys_setpriority((int)tf->tf_a0, (pid_t)tf->tf_a1, (int)tf->tf_a2);
+			break;
+
+		case SYS_getpriority:
+			err = sys_getpriority((int)tf->tf_a0, (pid_t)tf->tf_a1, &retval);
+			break;
+
+		case SYS_nanosleep:
+			err = sys_nanosleep((const_userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1);
+			break;
+
+		case SYS_getrusage:
+			err = sys_getrusage((int)tf->tf_a0, (userptr_t)tf->tf_a1);
+			break;
+
+		case SYS_futex_wait:
+			err = sys_futex_wait((userptr_t)tf->tf_a0, (uint32_t)tf->tf_a1, (const_userptr_t)tf->tf_a2);
+			break;
+
+		case SYS_futex_wake:
+			err = sys_futex_wake((userptr_t)tf->tf_a0, (int)tf->tf_a1, &retval);
+			break;
+
 	    default:
 		kprintf("Unknown syscall %d\n", callno);
 		err = ENOSYS;
 		break;
 	}
 
+	TRACE(TRACE_SYSRET, callno, err, retval);
 
 	if (err) {
 		/*
@@ -13,6 +13,8 @@
 #include <addrspace.h>
 #include <vm.h>
 #include <generic_vm.h>
+#include <counters.h>
+#include <trace.h>
 
 
 /*
@@ -91,6 +93,8 @@ core_map_init()
 
 	/* Initialize the core map spinlock */
 	spinlock_init(&core_map_spinlock);
+	spinlock_setname(&core_map_spinlock, "core_map_spinlock");
+	spinlock_setkind(&core_map_spinlock, SPINLOCK_TICKET);
 
 	/* Success */
 	return 0;
@@ -310,6 +314,8 @@ vm_tlbshootdown(const struct tlbshootdown *ts)
 int
 vm_fault(int faulttype, vaddr_t faultaddress)
 {
+	counter_inc(CTR_VMFAULT);
+
 	if (curproc == NULL) {
 		/*
 		 * No process. This is probably a kernel fault early
@@ -318,6 +324,7 @@ vm_fault(int faulttype, vaddr_t faultaddress)
 		 */
 		return EFAULT;
 	}
+	TRACE(TRACE_VMFAULT, faulttype, faultaddress, curproc->p_process_id);
 
 	struct addrspace *as = curproc_getas();
 	if (as == NULL) {
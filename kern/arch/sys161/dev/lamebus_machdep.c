@@ -40,6 +40,7 @@
 #include <membar.h>
 #include <synch.h>
 #include <mainbus.h>
+#include <prof.h>
 #include <sys161/bus.h>
 #include <lamebus/lamebus.h>
 #include "autoconf.h"
@@ -52,6 +53,10 @@
  */
 #define CPU_FREQUENCY 25000000 /* 25 MHz */
 
+/* Cycles per hardclock, and the most hardclocks one timer setting covers */
+#define TIMER_PERIOD    (CPU_FREQUENCY / HZ)
+#define TIMER_MAXTICKS  (0xffffffffU / TIMER_PERIOD)
+
 /*
  * Access to the on-chip timer.
  *
@@ -75,6 +80,26 @@ mips_timer_set(uint32_t count)
 		:: "r" (count));
 }
 
+/*
+ * Read the cycle counter. Since it restarts from zero each time the
+ * timer goes off or is set, this is the number of cycles since then.
+ */
+static
+uint32_t
+mips_timer_get(void)
+{
+	uint32_t count;
+
+	/* $9 == c0_count */
+	__asm volatile(
+		".set push;"		/* save assembler mode */
+		".set mips32;"		/* allow MIPS32 registers */
+		"mfc0 %0, $9;"		/* do it */
+		".set pop"		/* restore assembler mode */
+		: "=r" (count));
+	return count;
+}
+
 /*
  * LAMEbus data for the system. (We have only one LAMEbus per system.)
  * This does not need to be locked, because it's constant once
@@ -115,7 +140,33 @@ mainbus_bootstrap(void)
 	/*
 	 * Configure the MIPS on-chip timer to interrupt HZ times a second.
 	 */
-	mips_timer_set(CPU_FREQUENCY / HZ);
+	mips_timer_set(TIMER_PERIOD);
+}
+
+/*
+ * Idle cpus turn off their hardclock and just set the on-chip timer
+ * for the next thing they need to wake up for. (The ltimer card's
+ * countdown is one timer for the whole machine, and it's already
+ * busy with timerclock, so it's no use for this.)
+ */
+unsigned
+mainbus_timer_oneshot(unsigned ticks)
+{
+	if (ticks == 0 || ticks > TIMER_MAXTICKS) {
+		ticks = TIMER_MAXTICKS;
+	}
+	mips_timer_set(ticks * TIMER_PERIOD);
+	return ticks;
+}
+
+unsigned
+mainbus_timer_periodic(void)
+{
+	unsigned ticks;
+
+	ticks = mips_timer_get() / TIMER_PERIOD;
+	mips_timer_set(TIMER_PERIOD);
+	return ticks;
 }
 
 /*
@@ -304,10 +355,18 @@ mainbus_interrupt(struct trapframe *tf)
 		seen = true;
 	}
 	if (cause & MIPS_TIMER_BIT) {
-		/* Reset the timer (this clears the interrupt) */
-		mips_timer_set(CPU_FREQUENCY / HZ);
-		/* and call hardclock */
-		hardclock();
+		if (curcpu->c_tickless) {
+			/* An idle cpu's wakeup; this also restarts the ticks */
+			hardclock_resume(true);
+		}
+		else {
+			/* Reset the timer (this clears the interrupt) */
+			mips_timer_set(TIMER_PERIOD);
+			/* record where we were, for the profiler */
+			prof_sample(tf->tf_epc, (tf->tf_status & CST_KUp) != 0);
+			/* and call hardclock */
+			hardclock();
+		}
 		seen = true;
 	}
 
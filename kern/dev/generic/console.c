@@ -381,6 +381,8 @@ config_con(struct con_softc *cs, int unit)
 		sem_destroy(wsem);
 		return ENOMEM;
 	}
+	/* Hand the write lock straight to the next writer in line. */
+	lock_sethandoff(wlk, true);
 
 	cs->cs_rsem = rsem;
 	cs->cs_wsem = wsem;
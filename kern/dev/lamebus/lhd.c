@@ -39,6 +39,8 @@
 #include <synch.h>
 #include <platform/bus.h>
 #include <vfs.h>
+#include <counters.h>
+#include <trace.h>
 #include <lamebus/lhd.h>
 #include "autoconf.h"
 
@@ -235,6 +237,8 @@ lhd_io(struct device *d, struct uio *uio)
 		lhd_wreg(lh, LHD_REG_SECT, sector+i);
 
 		/* and start the operation. */
+		TRACE(TRACE_LHD_START, sector+i, 1,
+		      uio->uio_rw == UIO_WRITE);
 		lhd_wreg(lh, LHD_REG_STAT, statval);
 
 		/* Now wait until the interrupt handler tells us we're done. */
@@ -242,6 +246,7 @@ lhd_io(struct device *d, struct uio *uio)
 
 		/* Get the result value saved by the interrupt handler. */
 		result = lh->lh_result;
+		TRACE(TRACE_LHD_DONE, sector+i, 1, result);
 
 		/*
 		 * Are we reading? If so, and if we succeeded,
@@ -259,6 +264,8 @@ lhd_io(struct device *d, struct uio *uio)
 		if (result) {
 			return result;
 		}
+		counter_inc(uio->uio_rw == UIO_WRITE ?
+			    CTR_DISK_WRITE : CTR_DISK_READ);
 	}
 
 	return 0;
@@ -289,6 +296,8 @@ config_lhd(struct lhd_softc *lh, int lhdno)
 	if (lh->lh_clear == NULL) {
 		return ENOMEM;
 	}
+	/* lh_clear is used as a mutex; serve waiters in FIFO order. */
+	sem_sethandoff(lh->lh_clear, true);
 	lh->lh_done = sem_create("lhd-done", 0);
 	if (lh->lh_done == NULL) {
 		sem_destroy(lh->lh_clear);
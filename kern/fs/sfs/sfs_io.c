@@ -39,6 +39,7 @@
 #include <vfs.h>
 #include <device.h>
 #include <sfs.h>
+#include <trace.h>
 #include "sfsprivate.h"
 
 ////////////////////////////////////////////////////////////
@@ -294,6 +295,8 @@ sfs_io(struct sfs_vnode *sv, struct uio *uio)
 	uint32_t origresid, extraresid = 0;
 
 	origresid = uio->uio_resid;
+	TRACE(uio->uio_rw == UIO_READ ? TRACE_SFS_READ : TRACE_SFS_WRITE,
+	      sv->sv_ino, (uint32_t)uio->uio_offset, origresid);
 
 	/*
 	 * If reading, check for EOF. If we can read a partial area,
@@ -57,8 +57,19 @@ void hardclock_bootstrap(void);
 void hardclock(void);
 
 /*
- * timerclock() is called on one CPU once a second to allow simple
- * timed operations. (This is a fairly simpleminded interface.)
+ * An idle cpu has no use for hardclock. hardclock_idle() stops it
+ * until the cpu's next timer is due; hardclock_resume() restarts it
+ * when the cpu wakes up (for that or for anything else) and catches
+ * up on the ticks that were skipped. TIMER_EXPIRED says the wakeup is
+ * the idle timer going off, in which case exactly the ticks it was
+ * set for have passed. Both run with interrupts off.
+ */
+void hardclock_idle(void);
+void hardclock_resume(bool timer_expired);
+
+/*
+ * timerclock() is called on one CPU once a second. For timed
+ * operations use the timers in timer.h instead.
  */
 void timerclock(void);
 
@@ -84,8 +95,10 @@ void timespec_sub(const struct timespec *t1,
 /*
  * clocksleep() suspends execution for the requested number of seconds,
  * like userlevel sleep(3). (Don't confuse it with wchan_sleep.)
+ * clocksleep_ticks() does the same for a number of hardclocks.
  */
 void clocksleep(int seconds);
+void clocksleep_ticks(unsigned ticks);
 
 
 #endif /* _CLOCK_H_ */
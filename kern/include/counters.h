@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _COUNTERS_H_
+#define _COUNTERS_H_
+
+/*
+ * Per-cpu event counters.
+ *
+ * Each cpu has its own copy of every counter and only ever updates
+ * its own, with interrupts off for the moment it takes, so counting
+ * an event costs no locking and no shared cache lines. Reading a
+ * counter adds up all the cpus' copies; the total is a snapshot that
+ * may be a few events stale, which is fine for statistics.
+ *
+ * The totals can be read from userland through the "stat:" device
+ * (see devstat.c), one fixed-width line per counter.
+ */
+
+struct cpu;
+
+#define CTR_SYSCALL        0	/* system calls, all numbers */
+#define CTR_VMFAULT        1	/* calls to vm_fault */
+#define CTR_INTERRUPT      2	/* hardware interrupts */
+#define CTR_CTXSWITCH      3	/* context switches */
+#define CTR_PREEMPT        4	/* ...of which forced by the timer */
+#define CTR_KMALLOC        5	/* calls to kmalloc */
+#define CTR_KFREE          6	/* calls to kfree */
+#define CTR_DISK_READ      7	/* disk sectors read */
+#define CTR_DISK_WRITE     8	/* disk sectors written */
+#define CTR_NFIXED         9
+
+/* System calls by number: CTR_SYSCALL_BASE + callno. */
+#define CTR_SYSCALL_BASE   CTR_NFIXED
+#define CTR_NSYSCALLS      128
+
+#define NCOUNTERS          (CTR_SYSCALL_BASE + CTR_NSYSCALLS)
+
+/*
+ * counter_add   - add N to counter CTR on this cpu.
+ * counter_inc   - add one.
+ * counter_syscall - count system call CALLNO, both in CTR_SYSCALL and
+ *                 in its own counter.
+ * counter_get   - read one cpu's copy of CTR.
+ * counter_read  - read the total of CTR over all cpus.
+ * counter_name  - name of a fixed counter, for printing.
+ * counters_format - write the "stat:" text for all nonzero syscall
+ *                 counters and all fixed counters into BUF (at most
+ *                 LEN bytes), returning the length.
+ */
+void counter_add(unsigned ctr, uint64_t n);
+#define counter_inc(ctr) counter_add(ctr, 1)
+void counter_syscall(unsigned callno);
+uint64_t counter_get(struct cpu *c, unsigned ctr);
+uint64_t counter_read(unsigned ctr);
+const char *counter_name(unsigned ctr);
+size_t counters_format(char *buf, size_t len);
+
+/* Length of each line in the formatted output. */
+#define COUNTERS_LINELEN   40
+
+#endif /* _COUNTERS_H_ */
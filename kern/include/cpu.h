@@ -33,6 +33,12 @@
 
 #include <spinlock.h>
 #include <threadlist.h>
+#include <timer.h>
+#include <workqueue.h>
+#include <counters.h>
+
+struct prof_ring;	/* in prof.h */
+struct trace_ring;	/* in trace.h */
 #include <machine/vm.h>  /* for TLBSHOOTDOWN_MAX */
 
 
@@ -61,6 +67,11 @@ struct cpu {
 	struct threadlist c_zombies;	/* List of exited threads */
 	unsigned c_hardclocks;		/* Counter of hardclock() calls */
 	unsigned c_spinlocks;		/* Counter of spinlocks held */
+	unsigned c_sched_lastboost;	/* c_hardclocks at last MLFQ boost */
+	unsigned c_steal_seed;		/* PRNG state for work stealing */
+	uint64_t c_counters[NCOUNTERS];	/* Event counters; see counters.h */
+	bool c_tickless;		/* Idle with hardclock stopped */
+	unsigned c_tickless_ticks;	/* Hardclocks the idle timer was set for */
 
 	/*
 	 * Accessed by other cpus.
@@ -70,6 +81,30 @@ struct cpu {
 	struct threadlist c_runqueue;	/* Run queue for this cpu */
 	struct spinlock c_runqueue_lock;
 
+	/*
+	 * Timers armed on this cpu. Only this cpu adds to it or
+	 * advances it, but others may cancel. Protected by its own lock.
+	 */
+	struct timerwheel c_timerwheel;
+
+	/*
+	 * Deferred work for this cpu's worker thread. Protected by
+	 * its own lock.
+	 */
+	struct workqueue c_workqueue;
+
+	/*
+	 * Profiler samples; see prof.h. Written only by this cpu's
+	 * timer interrupt.
+	 */
+	struct prof_ring *c_profring;
+
+	/*
+	 * Trace events; see trace.h. Written only by this cpu, with
+	 * interrupts off.
+	 */
+	struct trace_ring *c_tracering;
+
 	/*
 	 * Accessed by other cpus.
 	 * Protected by the IPI lock.
@@ -110,6 +145,13 @@ void cpu_machdep_init(struct cpu *);
 /*ASMLINKAGE*/ void cpu_start_secondary(void);
 void cpu_hatch(unsigned software_number);
 
+/*
+ * Enumerate the cpus created so far: cpu_get(N) for N from 0 up to
+ * (but not including) cpu_count(). N is the software cpu number.
+ */
+unsigned cpu_count(void);
+struct cpu *cpu_get(unsigned num);
+
 /*
  * Produce a string describing the CPU type.
  */
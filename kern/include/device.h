@@ -77,6 +77,7 @@ struct vnode *dev_create_vnode(struct device *dev);
 
 /* Initialization functions for builtin vfs-level devices. */
 void devnull_create(void);
+void devstat_create(void);
 
 /* Function that kicks off device probe and attach. */
 void dev_bootstrap(void);
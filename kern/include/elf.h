@@ -193,8 +193,47 @@ typedef struct {
 #define	PF_X		0x1	/* Segment is executable */
 
 
+/*
+ * Section header, and symbol table entry. Not needed to load a
+ * program; the kernel profiler uses them to look up its own symbols.
+ * There are Ehdr.e_shnum section headers at Ehdr.e_shoff.
+ */
+typedef struct {
+	uint32_t	sh_name;      /* Section name (string table index) */
+	uint32_t	sh_type;      /* Type of section */
+	uint32_t	sh_flags;     /* Flags */
+	uint32_t	sh_addr;      /* Address when loaded */
+	uint32_t	sh_offset;    /* Location of data within file */
+	uint32_t	sh_size;      /* Size of data */
+	uint32_t	sh_link;      /* For a symbol table, its string table */
+	uint32_t	sh_info;      /* Type-dependent */
+	uint32_t	sh_addralign; /* Alignment */
+	uint32_t	sh_entsize;   /* Size of each entry, for tables */
+} Elf32_Shdr;
+
+/* values for sh_type (only the ones we use) */
+#define	SHT_NULL	0		/* Unused */
+#define	SHT_SYMTAB	2		/* Symbol table */
+#define	SHT_STRTAB	3		/* String table */
+
+typedef struct {
+	uint32_t	st_name;     /* Name (string table index) */
+	uint32_t	st_value;    /* Value; for functions, the address */
+	uint32_t	st_size;     /* Size; for functions, length of code */
+	unsigned char	st_info;     /* Type and binding */
+	unsigned char	st_other;    /* Ignore */
+	uint16_t	st_shndx;    /* Section it's defined in */
+} Elf32_Sym;
+
+/* symbol type, the low 4 bits of st_info (only the ones we use) */
+#define	ELF32_ST_TYPE(info)	((info) & 0xf)
+#define	STT_FUNC	2		/* Function */
+
+
 typedef Elf32_Ehdr Elf_Ehdr;
 typedef Elf32_Phdr Elf_Phdr;
+typedef Elf32_Shdr Elf_Shdr;
+typedef Elf32_Sym Elf_Sym;
 
 
 #endif /* _ELF_H_ */
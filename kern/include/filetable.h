@@ -35,6 +35,7 @@
 #define _FILETABLE_H_
 
 #include <limits.h> /* for OPEN_MAX */
+#include <spinlock.h>
 
 
 /*
@@ -48,14 +49,17 @@
  * or even to make it dynamic with the limit being user-settable. (See
  * setrlimit(2) on a Unix machine.)
  *
- * Because we only have single-threaded processes, the file table is
- * never shared and so it doesn't require synchronization. On fork,
- * the table is copied. Another exercise: what would you need to do to
- * make this code safe for multithreaded processes? What happens if
- * one thread calls close() while another one is in the middle of e.g.
- * read() using the same file handle?
+ * On fork, the table is copied. Even so, the table is written so
+ * that a file in use can't be pulled out from under its user:
+ * filetable_get takes a reference to the openfile while holding
+ * ft_lock, and filetable_put drops it, so if one thread calls close()
+ * or dup2() on a handle while another is in the middle of read() on
+ * it, the openfile survives until the read is done. ft_lock is a
+ * spinlock held only for a pointer swap or a refcount bump, so the
+ * read/write fast path never sleeps on a lock to find its file.
  */
 struct filetable {
+	struct spinlock ft_lock;	/* protects ft_openfiles */
 	struct openfile *ft_openfiles[OPEN_MAX];
 };
 
@@ -68,7 +72,8 @@ struct filetable {
  * okfd -    Check if a file handle is in range.
  * get/put - Retrieve a fd for use and put it back when done. (Checks
  *           okfd and also fails on files not open; returned openfile
- *           is not NULL.) Call put with the file returned from get.
+ *           is not NULL and holds a reference until put.) Call put
+ *           with the file returned from get.
  * place -   Insert a file and return the fd.
  * placeat - Insert a file at a specific slot and return the file
  *           previously there.
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _FUTEX_H_
+#define _FUTEX_H_
+
+/*
+ * Futexes: sleeping on a word of user memory.
+ *
+ * futex_wait puts the caller to sleep as long as the 32-bit word at
+ * UADDR still holds EXPECTED; futex_wake wakes up to N threads
+ * sleeping on UADDR. A waiter is identified by (address space, user
+ * virtual address), so only threads sharing an address space can wake
+ * each other. The kernel keeps no state for a word nobody is waiting
+ * on; the waiters live in a small hash table of wait queues.
+ *
+ * The point is that user code does the fast path (taking a free lock,
+ * releasing one nobody wants) with plain loads and stores, and only
+ * makes a system call to block or to wake someone.
+ *
+ *    futex_bootstrap - set up the hash table. Call once at boot.
+ *    futex_wait      - returns 0 once woken, EAGAIN if the word did not
+ *                      hold EXPECTED to begin with, ETIMEDOUT if TICKS
+ *                      is nonzero and that many hardclocks pass first,
+ *                      or an error from copyin.
+ *    futex_wake      - sets *WOKEN to the number of threads woken.
+ */
+
+struct addrspace;
+
+void futex_bootstrap(void);
+int futex_wait(struct addrspace *as, vaddr_t uaddr, uint32_t expected,
+	       unsigned ticks);
+void futex_wake(struct addrspace *as, vaddr_t uaddr, unsigned n,
+		unsigned *woken);
+
+#endif /* _FUTEX_H_ */
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2003, 2008
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _KERN_TRACE_H_
+#define _KERN_TRACE_H_
+
+/*
+ * Kernel event trace file format.
+ *
+ * The kernel's "trace save" menu command writes a struct trace_filehdr
+ * followed by th_nevents struct trace_events, in the kernel's byte
+ * order (the decoder can tell from th_magic whether to swap). Events
+ * are grouped by cpu; within a cpu they are in the order they happened.
+ * Timestamps come from the system clock (the LAMEbus timer), so events
+ * from different cpus can be merged into one timeline by time.
+ */
+
+#define TRACE_MAGIC     0x54524331	/* "TRC1" */
+
+struct trace_filehdr {
+	uint32_t th_magic;	/* TRACE_MAGIC */
+	uint32_t th_ncpus;	/* number of cpus traced */
+	uint32_t th_nevents;	/* number of events that follow */
+	uint32_t th_lost;	/* events overwritten before saving */
+};
+
+struct trace_event {
+	uint32_t te_sec;	/* timestamp */
+	uint32_t te_nsec;
+	uint16_t te_type;	/* TRACE_* below */
+	uint16_t te_cpu;	/* cpu number */
+	uint32_t te_arg[3];	/* depends on te_type */
+};
+
+/*
+ * Event types and their arguments.
+ */
+#define TRACE_SWITCH        1	/* old pid, new pid, old thread's new state */
+#define TRACE_SYSCALL       2	/* call number, pid, 0 */
+#define TRACE_SYSRET        3	/* call number, errno (0 for success), retval */
+#define TRACE_VMFAULT       4	/* fault type, fault address, pid */
+#define TRACE_LHD_START     5	/* sector, sector count, 1 if write */
+#define TRACE_LHD_DONE      6	/* sector, sector count, errno */
+#define TRACE_SFS_READ      7	/* inode number, offset, length */
+#define TRACE_SFS_WRITE     8	/* inode number, offset, length */
+
+#endif /* _KERN_TRACE_H_ */
@@ -194,5 +194,8 @@ void kprintf_bootstrap(void);
 #define DIVROUNDUP(a,b) (((a)+(b)-1)/(b))
 #define ROUNDUP(a,b)    (DIVROUNDUP(a,b)*b)
 
+/* Sort N uint32_ts into ascending order, in place. */
+void sort_uint32(uint32_t *a, unsigned n);
+
 
 #endif /* _LIB_H_ */
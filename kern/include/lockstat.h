@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _LOCKSTAT_H_
+#define _LOCKSTAT_H_
+
+/*
+ * Lock contention profiler.
+ *
+ * While profiling is on, every acquisition that has to wait is
+ * charged to the name of the lock it waited for: spinlocks record
+ * how many times they went around the spin loop, and the sleeping
+ * primitives (locks, semaphores, CVs) record how long they waited,
+ * as measured by gettime(). Locks with the same name are added up
+ * together, so e.g. all the per-file "fd_lock"s show up as one line.
+ *
+ * Uncontended acquisitions are never looked at, and contended ones
+ * only test lockstat_enabled, so leaving this compiled in costs next
+ * to nothing while it is off.
+ */
+
+struct timespec;
+
+/* What kind of lock an entry is for. */
+#define LOCKSTAT_SPIN   0       /* spinlock; total is spin iterations */
+#define LOCKSTAT_LOCK   1       /* sleep lock; total is nanoseconds */
+#define LOCKSTAT_SEM    2       /* semaphore P; total is nanoseconds */
+#define LOCKSTAT_CV     3       /* cv_wait; total is nanoseconds */
+
+extern volatile bool lockstat_enabled;
+
+/*
+ * Record a contended acquisition. lockstat_wait computes the wait time
+ * from START, which the caller takes with gettime() when it first finds
+ * the lock busy (and only if lockstat_enabled is set).
+ */
+void lockstat_spin(const char *name, unsigned spins);
+void lockstat_wait(int kind, const char *name, const struct timespec *start);
+
+/*
+ * Control, for the kernel menu.
+ *
+ *    lockstat_start - turn profiling on.
+ *    lockstat_stop  - turn profiling off; collected data is kept.
+ *    lockstat_reset - throw away collected data.
+ *    lockstat_dump  - print collected data, worst offenders first.
+ */
+void lockstat_start(void);
+void lockstat_stop(void);
+void lockstat_reset(void);
+void lockstat_dump(void);
+
+#endif /* _LOCKSTAT_H_ */
@@ -55,6 +55,21 @@ size_t mainbus_ramsize(void);
 /* Switch on an inter-processor interrupt. (Low-level.) */
 void mainbus_send_ipi(struct cpu *target);
 
+/*
+ * Per-cpu hardclock timer control, for idle cpus (see clock.c).
+ *
+ * mainbus_timer_oneshot stops the current cpu's periodic hardclock
+ * interrupts and asks for a single timer interrupt about TICKS
+ * hardclock periods from now instead, or as late as the hardware
+ * allows if TICKS is 0 or too big; it returns the number of periods
+ * actually set. mainbus_timer_periodic goes back to periodic
+ * interrupts and returns how many whole hardclock periods went by in
+ * between. That count is only meaningful if the one-shot interrupt
+ * has not yet gone off, since the cycle counter restarts when it does.
+ */
+unsigned mainbus_timer_oneshot(unsigned ticks);
+unsigned mainbus_timer_periodic(void);
+
 /*
  * The various ways to shut down the system. (These are very low-level
  * and should generally not be called directly - md_poweroff, for
@@ -51,8 +51,10 @@
 struct openfile {
 	struct vnode *of_vnode;
 	int of_accmode;	/* from open: O_RDONLY, O_WRONLY, or O_RDWR */
+	bool of_seekable;	/* VOP_ISSEEKABLE */
 
-	struct lock *of_offsetlock;	/* lock for of_offset */
+	struct lock *of_offsetlock;	/* lock for of_offset (seekable) */
+	struct spinlock of_streamlock;	/* lock for of_offset (not seekable) */
 	off_t of_offset;
 
 	struct spinlock of_reflock;	/* lock for of_refcount */
@@ -60,9 +62,26 @@ struct openfile {
 };
 
 /* open a file (args must be kernel pointers; destroys filename) */
+struct openfile *openfile_create(struct vnode *vn, int accmode);
 int openfile_open(char *filename, int openflags, mode_t mode,
 		  struct openfile **ret);
 
+/*
+ * Seek position handling for I/O through the shared offset (read,
+ * write, and friends). openfile_startio returns the offset to do the
+ * I/O at; openfile_endio takes the offset the I/O started at and where
+ * it finished (the same value if nothing should be consumed).
+ *
+ * For seekable files the offset lock is held from start to end, so
+ * concurrent I/O on a shared open file is serialized. Files that can't
+ * seek don't hold it across the I/O, since e.g. a console read can
+ * block indefinitely; their offset is still tracked, because some
+ * devices (such as stat:) serve data by offset, and is just advanced
+ * by the amount transferred.
+ */
+off_t openfile_startio(struct openfile *file);
+void openfile_endio(struct openfile *file, off_t start, off_t end);
+
 /* adjust the refcount on an openfile */
 void openfile_incref(struct openfile *);
 void openfile_decref(struct openfile *);
@@ -42,7 +42,7 @@
 
 struct addrspace;
 struct vnode;
-struct fd_table;
+struct filetable;
 
 /*
  * Process structure.
@@ -58,33 +58,48 @@ struct proc {
 	/* VFS */
 	struct vnode *p_cwd;			/* current working directory */
 
-	/* FD Table */
-	struct fd_table *p_fd_table;  			/* process's file descriptor table */
+	/* File table; NULL until runprogram opens stdin/out/err or fork copies it */
+	struct filetable *p_filetable;  		/* process's file descriptor table */
 
 	/* Process ID */
 	pid_t p_process_id;						/* Process's Process ID */
 
-    /* PID table */
-    struct array *p_child_process_arr;       /* Process's children PIDs */
-	struct lock *p_parent_lock;
+    /* Children; the fields below are protected by proc_family_lock */
+    struct array *p_child_process_arr;       /* Process's children (unreaped) */
 	unsigned p_child_index;  				/* Index in parent's child array */
 
 	int p_num_children_running;
 
-	struct proc *p_parent_process;
+	struct proc *p_parent_process;			/* NULL once orphaned */
 
-	struct cv *p_parent_cv;
+	struct cv *p_exit_cv;					/* Parent waits here for us to exit */
+	struct cv *p_child_exit_cv;				/* We wait here for any child to exit */
 
 	/* Exit Status */
 	int p_exit_status;
 
 	/* Process Exited or not */
 	uint8_t p_is_zombie;
+
+	/* setpriority() value; 0 means scheduled dynamically by the MLFQ */
+	int p_priority;
+
+	/* CPU accounting carried over from threads that have exited (p_lock) */
+	unsigned p_cputime;						/* hardclocks */
+	unsigned p_nvcsw;						/* voluntary context switches */
+	unsigned p_nivcsw;						/* involuntary context switches */
 };
 
 /* This is the process structure for the kernel and for kernel-only threads. */
 extern struct proc *kproc;
 
+/*
+ * Protects the parent/child relationships between processes: the
+ * child arrays, parent pointers, and exit status. Nothing slow is
+ * done while holding it.
+ */
+extern struct lock *proc_family_lock;
+
 /* Call once during system startup to allocate data structures. */
 void proc_bootstrap(void);
 
@@ -100,14 +115,17 @@ int proc_addthread(struct proc *proc, struct thread *t);
 /* Detach a thread from its process. */
 void proc_remthread(struct thread *t);
 
+/* Total CPU accounting over a process's threads, live and exited. */
+void proc_getusage(struct proc *proc, unsigned *cputime, unsigned *nvcsw, unsigned *nivcsw);
+
 /* Fetch the address space of the current process. */
 struct addrspace *proc_getas(void);
 
 /* Change the address space of the current process, and return the old one. */
 struct addrspace *proc_setas(struct addrspace *);
 
-/* Get a new process ID. Returns the lowest available process ID */
-pid_t get_process_id(void);
+/* Get a new process ID for PROC and record PROC under it. Returns 0 if none are free. */
+pid_t get_process_id(struct proc *proc);
 
 /* Deallocate a process ID. Returns 0 on success and -1 on failure. */
 int dealloc_process_id(pid_t pid_to_dealloc);
@@ -115,5 +133,21 @@ int dealloc_process_id(pid_t pid_to_dealloc);
 /* Get PID Status. Returns 0 if available, 1 if allocated , and 2 if PID is invalid. */
 uint8_t get_pid_status(pid_t pid);
 
+/* Find the child of PARENT with process ID PID. Returns NULL if there is none. */
+struct proc *proc_find_child(struct proc *parent, pid_t pid);
+
+/* Add CHILD to / remove CHILD from PARENT's children. Hold proc_family_lock. */
+int proc_addchild(struct proc *parent, struct proc *child);
+void proc_remchild(struct proc *parent, struct proc *child);
+
+/* Return a zombie child of PARENT, or NULL if there is none. Hold proc_family_lock. */
+struct proc *proc_find_zombie(struct proc *parent);
+
+/* Exit the current process with wait status WAITSTATUS. Does not return. */
+__DEAD void proc_exit(int waitstatus);
+
+/* Remove zombie CHILD from PARENT's children and destroy it in the background. */
+void proc_reap(struct proc *parent, struct proc *child);
+
 
 #endif /* _PROC_H_ */
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _PROF_H_
+#define _PROF_H_
+
+/*
+ * Sampling profiler.
+ *
+ * While profiling is on, every hardclock records where the cpu was
+ * interrupted: the PC from the trapframe, whether it was in user or
+ * kernel mode, and the pid of the process it was running (0 for
+ * kernel-only threads). Samples go into a ring buffer per cpu, which
+ * only that cpu writes, from its timer interrupt; when a ring fills up
+ * the oldest samples are overwritten.
+ *
+ * prof_dump prints a histogram of kernel samples by function and of
+ * user samples by pid. There is no symbol table in the running kernel,
+ * so function names are looked up in the kernel's ELF image, read
+ * back from a file (normally the one sys161 booted, on emu0).
+ *
+ * prof_save writes the raw samples to a file: a struct prof_filehdr
+ * followed by pf_nsamples struct prof_samples, in the kernel's byte
+ * order, for looking at offline (e.g. with the kernel's nm output).
+ */
+
+#define PROF_RINGSIZE   2048	/* samples per cpu */
+#define PROF_DEFAULT_KERNEL "emu0:kernel"
+
+struct prof_sample {
+	uint32_t ps_pc;		/* interrupted PC */
+	uint16_t ps_pid;	/* pid, or 0 */
+	uint8_t ps_cpu;		/* cpu number */
+	uint8_t ps_user;	/* 1 if in user mode */
+};
+
+#define PROF_MAGIC      0x50524631	/* "PRF1" */
+
+struct prof_filehdr {
+	uint32_t pf_magic;	/* PROF_MAGIC */
+	uint32_t pf_hz;		/* samples per second per cpu (HZ) */
+	uint32_t pf_nsamples;	/* number of samples that follow */
+	uint32_t pf_lost;	/* samples overwritten before saving */
+};
+
+struct prof_ring {
+	unsigned pr_total;	/* samples ever taken; next slot is % size */
+	struct prof_sample pr_samples[PROF_RINGSIZE];
+};
+
+/*
+ * Called by the machine-dependent timer interrupt code on each
+ * hardclock, with the interrupted PC and mode.
+ */
+void prof_sample(vaddr_t pc, bool user);
+
+/*
+ * Control, for the kernel menu.
+ *
+ *    prof_start - throw away old samples and start sampling.
+ *                 Returns ENOMEM if the rings can't be allocated.
+ *    prof_stop  - stop sampling; samples are kept.
+ *    prof_dump  - print the histograms, top NFUNCS functions,
+ *                 symbolized from the ELF file KERNELPATH.
+ *    prof_save  - write the raw samples to PATH.
+ */
+int prof_start(void);
+void prof_stop(void);
+void prof_dump(unsigned nfuncs, const char *kernelpath);
+int prof_save(const char *path);
+
+#endif /* _PROF_H_ */
@@ -45,6 +45,30 @@
 /* Get the machine-dependent bits. */
 #include <machine/spinlock.h>
 
+/*
+ * Spinlock flavors.
+ *
+ * SPINLOCK_TTAS	Test-and-test-and-set (the default). Cheapest when
+ *			uncontended, but unfair: whichever CPU's SC lands
+ *			first wins, and a CPU that just released the lock
+ *			is well placed to win again.
+ * SPINLOCK_BACKOFF	TTAS with exponential backoff after each lost
+ *			race, to cut down on LL/SC traffic.
+ * SPINLOCK_TICKET	Ticket lock: CPUs take a number and are served in
+ *			arrival order, with backoff proportional to how
+ *			far back in line they are. Use for hot locks
+ *			where starvation shows up.
+ */
+typedef enum {
+	SPINLOCK_TTAS,
+	SPINLOCK_BACKOFF,
+	SPINLOCK_TICKET,
+} spinlock_kind_t;
+
+/* Backoff delay bounds, in busy-loop iterations. */
+#define SPINLOCK_BACKOFF_MIN	4
+#define SPINLOCK_BACKOFF_MAX	1024
+
 /*
  * Basic spinlock.
  *
@@ -56,13 +80,23 @@
  */
 struct spinlock {
 	volatile spinlock_data_t splk_lock; /* Memory word where we spin. */
+	volatile spinlock_data_t splk_next; /* Ticket dispenser. */
+	volatile spinlock_data_t splk_serving; /* Ticket now served. */
 	struct cpu *splk_holder;	    /* CPU holding this lock. */
+	const char *splk_name;		    /* For lockstat; may be NULL. */
+	spinlock_kind_t splk_kind;	    /* Acquire algorithm. */
 };
 
 /*
  * Initializer for cases where a spinlock needs to be static or global.
  */
-#define SPINLOCK_INITIALIZER	{ SPINLOCK_DATA_INITIALIZER, NULL }
+#define SPINLOCK_INITIALIZER_KIND(name, kind) \
+	{ SPINLOCK_DATA_INITIALIZER, SPINLOCK_DATA_INITIALIZER, \
+	  SPINLOCK_DATA_INITIALIZER, NULL, name, kind }
+#define SPINLOCK_INITIALIZER \
+	SPINLOCK_INITIALIZER_KIND(NULL, SPINLOCK_TTAS)
+#define SPINLOCK_INITIALIZER_NAMED(name) \
+	SPINLOCK_INITIALIZER_KIND(name, SPINLOCK_TTAS)
 
 /*
  * Spinlock functions.
@@ -74,6 +108,11 @@ struct spinlock {
  * release	Release the lock. May re-enable interrupts.
  *
  * do_i_hold	Check if the current CPU holds the lock.
+ *
+ * setname	Give the lock a name to report contention under (see
+ *		lockstat.h). The string is not copied.
+ * setkind	Choose the acquire algorithm. Lock must be unlocked and
+ *		have no waiters, so in practice call it right after init.
  */
 
 void spinlock_init(struct spinlock *lk);
@@ -84,5 +123,8 @@ void spinlock_release(struct spinlock *lk);
 
 bool spinlock_do_i_hold(struct spinlock *lk);
 
+void spinlock_setname(struct spinlock *lk, const char *name);
+void spinlock_setkind(struct spinlock *lk, spinlock_kind_t kind);
+
 
 #endif /* _SPINLOCK_H_ */
@@ -48,6 +48,8 @@ struct semaphore {
 	struct wchan *sem_wchan;
 	struct spinlock sem_lock;
         volatile unsigned sem_count;
+        bool sem_handoff;               /* V hands the count to a waiter */
+        unsigned sem_granted;           /* handed off, not yet picked up */
 };
 
 struct semaphore *sem_create(const char *name, unsigned initial_count);
@@ -58,11 +60,34 @@ void sem_destroy(struct semaphore *);
  *     P (proberen): decrement count. If the count is 0, block until
  *                   the count is 1 again before decrementing.
  *     V (verhogen): increment count.
+ *
+ * By default a thread arriving in P can take a count that V made
+ * while other threads were already waiting for it. That is cheap but
+ * unfair: an unlucky waiter can lose out over and over. In handoff
+ * mode, V with waiters gives the count directly to the one that has
+ * waited longest, so waiters are served in FIFO order. Set the mode
+ * with sem_sethandoff before the semaphore is used.
  */
 void P(struct semaphore *);
 void V(struct semaphore *);
+void sem_sethandoff(struct semaphore *, bool handoff);
 
 
+/*
+ * Per-lock contention statistics.
+ *
+ * ls_spins counts iterations of the spin loop in lock_acquire; it
+ * stands in for spin time. ls_spinwins counts contended acquisitions
+ * that were satisfied by spinning, without having to sleep.
+ */
+struct lock_stats {
+    unsigned ls_acquires;       /* total acquisitions */
+    unsigned ls_contended;      /* acquisitions that found the lock held */
+    unsigned ls_spinwins;       /* contended, but got it while spinning */
+    unsigned ls_sleeps;         /* times a waiter went to sleep */
+    uint64_t ls_spins;          /* spin loop iterations */
+};
+
 /*
  * Simple lock for mutual exclusion.
  *
@@ -85,6 +110,14 @@ struct lock {
     struct thread *lk_owner; 
     //the lock value to determine if the lock is free or taken
     volatile bool lk_flag; //false lock is available, true lock is taken
+
+    //contention statistics, protected by lk_spinlock
+    struct lock_stats lk_stats;
+
+    //handoff mode: lock_release passes the lock to the longest waiter
+    bool lk_handoff;
+    //set by a handoff release until the woken waiter claims the lock
+    bool lk_granted;
 };
 
 struct lock *lock_create(const char *name);
@@ -98,12 +131,27 @@ void lock_destroy(struct lock *);
  *                   this.
  *    lock_do_i_hold - Return true if the current thread holds the lock;
  *                   false otherwise.
+ *    lock_getstats - Copy out the lock's contention statistics.
+ *
+ * If the lock is held by a thread that is running on another CPU,
+ * lock_acquire spins for a bounded time waiting for it to be released
+ * before going to sleep, since the locks in this kernel are mostly
+ * held only briefly and sleeping costs two context switches.
+ *
+ *    lock_sethandoff - In handoff mode, lock_release gives the lock
+ *                   straight to the thread that has slept on it
+ *                   longest, instead of freeing it for anyone
+ *                   (including spinners and new arrivals) to grab.
+ *                   This bounds how long any waiter can wait, at the
+ *                   cost of throughput. Set before the lock is used.
  *
  * These operations must be atomic. You get to write them.
  */
 void lock_acquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_do_i_hold(struct lock *);
+void lock_getstats(struct lock *, struct lock_stats *ret);
+void lock_sethandoff(struct lock *, bool handoff);
 
 
 /*
@@ -140,18 +188,75 @@ void cv_destroy(struct cv *);
  * Operations:
  *    cv_wait      - Release the supplied lock, go to sleep, and, after
  *                   waking up again, re-acquire the lock.
+ *    cv_timedwait - Like cv_wait, but give up waiting after TICKS
+ *                   hardclocks. The lock is re-acquired either way.
+ *                   Returns 0 if woken by signal/broadcast, otherwise
+ *                   ETIMEDOUT.
  *    cv_signal    - Wake up one thread that's sleeping on this CV.
  *    cv_broadcast - Wake up all threads sleeping on this CV.
  *
- * For all three operations, the current thread must hold the lock passed
+ * For all these operations, the current thread must hold the lock passed
  * in. Note that under normal circumstances the same lock should be used
  * on all operations with any particular CV.
  *
  * These operations must be atomic. You get to write them.
  */
 void cv_wait(struct cv *cv, struct lock *lock);
+int cv_timedwait(struct cv *cv, struct lock *lock, unsigned ticks);
 void cv_signal(struct cv *cv, struct lock *lock);
 void cv_broadcast(struct cv *cv, struct lock *lock);
 
 
+/*
+ * Reader-writer lock.
+ *
+ * Any number of readers may hold the lock at once, or one writer.
+ *
+ * Writers are preferred: once a writer is waiting, newly arriving
+ * readers queue up behind it rather than joining the readers already
+ * inside. To keep readers from starving in turn, when a writer
+ * releases the lock every reader waiting at that moment is let in
+ * together, ahead of any other waiting writers. So readers and
+ * writers alternate in batches under contention, and neither side
+ * can be locked out forever.
+ *
+ * The name field is for easier debugging. A copy of the name is
+ * made internally.
+ */
+struct rwlock {
+        char *rwlock_name;
+
+        // protects everything below, and both wait channels
+        struct spinlock rw_spinlock;
+        struct wchan *rw_read_wchan;
+        struct wchan *rw_write_wchan;
+
+        volatile unsigned rw_readers;           // readers inside (or let in)
+        struct thread *rw_writer;               // writer inside, if any
+        unsigned rw_waiting_readers;
+        unsigned rw_waiting_writers;
+        unsigned rw_read_gen;                   // bumped to let waiting readers in
+};
+
+struct rwlock *rwlock_create(const char *name);
+void rwlock_destroy(struct rwlock *);
+
+/*
+ * Operations:
+ *    rwlock_acquire_read  - Get the lock for reading. Other threads may
+ *                           hold it for reading at the same time.
+ *    rwlock_release_read  - Free a read hold on the lock.
+ *    rwlock_acquire_write - Get the lock for writing. No other thread
+ *                           holds it at all while we do.
+ *    rwlock_release_write - Free the lock after writing. Only the
+ *                           thread that acquired it may do this.
+ *
+ * These operations must be atomic.
+ */
+void rwlock_acquire_read(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
+
+
 #endif /* _SYNCH_H_ */
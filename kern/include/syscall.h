@@ -68,8 +68,15 @@ int sys_open(const char *filename, int flags, mode_t mode, int *fd_num);
 int sys_read(int fd, void *buf, size_t buflen, ssize_t *bytes_read);
 int sys_write(int fd, const void *buf, size_t nbytes, ssize_t *bytes_written);
 int sys_lseek(int fd, off_t pos, int whence, int32_t *upper_32_ret, int32_t *lower_32_ret);
+int sys_pread(int fd, void *buf, size_t buflen, off_t pos, ssize_t *bytes_read);
+int sys_pwrite(int fd, const void *buf, size_t nbytes, off_t pos, ssize_t *bytes_written);
+int sys_readv(int fd, const_userptr_t iov, int iovcnt, ssize_t *bytes_read);
+int sys_writev(int fd, const_userptr_t iov, int iovcnt, ssize_t *bytes_written);
+int sys_copy_file_range(int infd, userptr_t inpos, int outfd, userptr_t outpos,
+                        size_t len, unsigned flags, ssize_t *bytes_copied);
 int sys_close(int fd);
 int sys_dup2(int oldfd, int newfd, int *new_fd_num);
+int sys_pipe(userptr_t filehandles);
 int sys_chdir(const char *pathname);
 int sys___getcwd(char *buf, size_t buflen, ssize_t *sys___getcwd_bytes_returned);
 
@@ -87,6 +94,16 @@ void sys__exit(int exitcode);
  */
 int sys_sbrk(ssize_t amount, int32_t *ret_addr);
 
+/* 
+ * Prototypes for IN_KERNEL entry points for scheduler system calls.
+ */
+int sys_setpriority(int which, pid_t who, int prio);
+int sys_getpriority(int which, pid_t who, int *ret_prio);
+int sys_nanosleep(const_userptr_t req, userptr_t rem);
+int sys_getrusage(int who, userptr_t usage);
+int sys_futex_wait(userptr_t addr, uint32_t expected, const_userptr_t timeout);
+int sys_futex_wake(userptr_t addr, int n, int *retval);
+
 /* 
  * Helper functions for system calls in Assignment 5.
  */
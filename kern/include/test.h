@@ -56,6 +56,10 @@ int semtest(int, char **);
 int locktest(int, char **);
 int cvtest(int, char **);
 int cvtest2(int, char **);
+int rwtest(int, char **);
+int timedwaittest(int, char **);
+int spintest(int, char **);
+int lockbench(int, char **);
 
 /* filesystem tests */
 int fstest(int, char **);
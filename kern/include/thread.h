@@ -46,6 +46,28 @@ struct cpu;
 #include <machine/thread.h>
 
 
+/*
+ * Multi-level feedback queue scheduler.
+ *
+ * Level 0 is the most urgent. Threads enter at level 0, drop a level
+ * each time they use up SCHED_ALLOTMENT(level) hardclocks of CPU at
+ * their current level, and rise a level each time they block on a
+ * wait channel. Every so often all threads are boosted back to level
+ * 0 so that CPU hogs cannot be starved forever.
+ *
+ * A thread that is dispatched gets a time slice of SCHED_QUANTUM(level)
+ * hardclocks. The timer only preempts it once the slice is used up,
+ * and then only if something else is waiting to run on its CPU;
+ * otherwise it just gets a fresh slice.
+ *
+ * SCHED_DYNAMIC is passed to thread_set_schedclass to put a thread
+ * back under MLFQ control after it has been pinned to a level.
+ */
+#define SCHED_NLEVELS		4
+#define SCHED_ALLOTMENT(level)	(2U << (level))
+#define SCHED_QUANTUM(level)	(1U << (level))
+#define SCHED_DYNAMIC		(-1)
+
 /* Size of kernel stacks; must be power of 2 */
 #define STACK_SIZE 4096
 
@@ -72,6 +94,7 @@ struct thread {
 	 */
 	char *t_name;			/* Name of this thread */
 	const char *t_wchan_name;	/* Name of wait channel, if sleeping */
+	struct wchan *t_wchan;		/* Wait channel, if sleeping; under its lock */
 	threadstate_t t_state;		/* State this thread is in */
 
 	/*
@@ -83,6 +106,29 @@ struct thread {
 	struct switchframe *t_context;	/* Saved register context (on stack) */
 	struct cpu *t_cpu;		/* CPU thread runs on */
 	struct proc *t_proc;		/* Process thread belongs to */
+	bool t_bound;			/* never migrated off t_cpu */
+
+	/*
+	 * Scheduler (MLFQ) fields. While the thread is on a run queue
+	 * these are protected by that queue's lock; otherwise only the
+	 * thread itself touches them.
+	 */
+	unsigned t_sched_level;		/* MLFQ level; 0 is most urgent */
+	unsigned t_sched_ticks;		/* hardclocks used at this level */
+	unsigned t_sched_lastrun;	/* c_hardclocks when last dispatched */
+	bool t_sched_pinned;		/* level fixed by setpriority() */
+	bool t_sched_classpending;	/* t_sched_newclass not applied yet */
+	int t_sched_newclass;		/* class to apply when next queued */
+	unsigned t_slice;		/* hardclocks left in time slice */
+
+	/*
+	 * CPU accounting. Only updated by the thread's own cpu while
+	 * it runs; others may read them for statistics.
+	 */
+	unsigned t_cputime;		/* hardclocks spent running */
+	unsigned t_nvcsw;		/* switches away by blocking/yielding */
+	unsigned t_nivcsw;		/* switches away by preemption */
+	bool t_preempted;		/* being switched out by the timer */
 
 	/*
 	 * Interrupt state fields.
@@ -144,6 +190,14 @@ int thread_fork(const char *name, struct proc *proc,
                 void (*func)(void *, unsigned long),
                 void *data1, unsigned long data2);
 
+/*
+ * Like thread_fork, but the new thread starts on cpu C and stays
+ * there: work stealing leaves it alone. For per-cpu service threads.
+ */
+int thread_fork_bound(struct cpu *c, const char *name, struct proc *proc,
+                      void (*func)(void *, unsigned long),
+                      void *data1, unsigned long data2);
+
 /*
  * Cause the current thread to exit.
  * Interrupts need not be disabled.
@@ -163,10 +217,23 @@ void thread_yield(void);
 void schedule(void);
 
 /*
- * Potentially migrate ready threads to other CPUs. Called from the
+ * Charge the current thread a hardclock and preempt it if its time
+ * slice is up and something else wants the cpu. Called from the
  * timer interrupt.
  */
-void thread_consider_migration(void);
+void thread_timeslice(void);
+
+/*
+ * Print per-cpu context switch statistics.
+ */
+void thread_printstats(void);
+
+/*
+ * Pin a thread to MLFQ level LEVEL, or return it to dynamic
+ * scheduling if LEVEL is SCHED_DYNAMIC. Takes the thread's run
+ * queue lock.
+ */
+void thread_set_schedclass(struct thread *t, int level);
 
 
 #endif /* _THREAD_H_ */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+/*
+ * Kernel timers.
+ *
+ * A timer calls a function once, a given number of hardclock ticks
+ * from when it is armed. Each CPU has its own timer wheel, advanced
+ * by hardclock(), and a timer stays on the wheel of the CPU that
+ * armed it.
+ *
+ * The wheel is hierarchical: TIMERWHEEL_LEVELS wheels of
+ * TIMERWHEEL_SLOTS slots each, where a slot on level N covers
+ * TIMERWHEEL_SLOTS^N ticks. Arming and cancelling are O(1); each
+ * time a lower wheel wraps around, one slot of the wheel above is
+ * redistributed ("cascaded") downwards. Timers further out than the
+ * whole wheel covers (2^24 ticks) are parked on the top level and
+ * placed again when that slot comes round.
+ *
+ * Timer functions run from hardclock, in interrupt context, with no
+ * spinlocks held. They may take spinlocks and wake threads but must
+ * not sleep.
+ */
+
+#include <spinlock.h>
+
+struct timespec;
+
+#define TIMERWHEEL_BITS    6
+#define TIMERWHEEL_SLOTS   (1 << TIMERWHEEL_BITS)
+#define TIMERWHEEL_LEVELS  4
+
+struct timer {
+	struct timer *tm_next;		/* Link in wheel slot */
+	struct timer **tm_pprev;	/* Pointer to whatever points at us */
+	uint64_t tm_expires;		/* Wheel time at which to fire */
+	struct timerwheel *tm_wheel;	/* Wheel we were last armed on */
+	bool tm_pending;		/* On a wheel and not yet fired */
+	void (*tm_func)(void *);	/* Function to call */
+	void *tm_arg;			/* Argument for tm_func */
+};
+
+struct timerwheel {
+	struct spinlock tw_lock;
+	uint64_t tw_now;		/* Ticks since the wheel started */
+	struct timer *tw_slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];
+	struct timer *tw_expired;	/* Due this tick, not yet run */
+	struct timer *tw_running;	/* Timer whose function is running */
+	unsigned tw_count;		/* Number of pending timers */
+};
+
+/*
+ * Timer functions.
+ *
+ *    timer_init      - set up a timer to call FUNC(ARG). Not armed.
+ *    timer_add       - arm the timer on the current CPU's wheel, to fire
+ *                      after TICKS hardclocks (at least one). Must not
+ *                      already be pending.
+ *    timer_cancel    - disarm the timer. Returns true if it was pending
+ *                      and now will not fire. If the function is running
+ *                      on another CPU, waits for it to finish, so once
+ *                      this returns the timer may be freed.
+ *
+ *    timer_hardclocks - convert a time interval to hardclock ticks,
+ *                      rounding up.
+ *
+ *    timerwheel_init - set up a CPU's wheel; called from cpu_create.
+ *    timerwheel_tick - advance the current CPU's wheel by one tick and
+ *                      run any timers that come due; called by hardclock.
+ *    timerwheel_advance - same, for several ticks at once.
+ *    timerwheel_idle_ticks - how many ticks until the current CPU's wheel
+ *                      next has anything to do; 0 if it has no timers.
+ */
+void timer_init(struct timer *tm, void (*func)(void *), void *arg);
+void timer_add(struct timer *tm, unsigned ticks);
+bool timer_cancel(struct timer *tm);
+
+unsigned timer_hardclocks(const struct timespec *ts);
+
+void timerwheel_init(struct timerwheel *tw);
+void timerwheel_tick(void);
+void timerwheel_advance(unsigned ticks);
+unsigned timerwheel_idle_ticks(void);
+
+#endif /* _TIMER_H_ */
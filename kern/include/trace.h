@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+/*
+ * Kernel event tracing.
+ *
+ * Tracepoints are compiled in at interesting places (see the event
+ * types in <kern/trace.h>) and cost one test of trace_enabled while
+ * tracing is off. While it is on, each event is stamped with the time
+ * and written into a ring buffer belonging to the cpu it happened on.
+ * A cpu only ever writes its own ring, with interrupts off for the
+ * moment it takes, so no locks are involved and tracing doesn't
+ * serialize the cpus the way kprintf does. When a ring fills, the
+ * oldest events are overwritten.
+ *
+ * "trace save FILE" in the menu writes the rings out in the format of
+ * <kern/trace.h>; the tracedump program turns that into a timeline.
+ */
+
+#include <kern/trace.h>
+
+#define TRACE_RINGSIZE  1024	/* events per cpu */
+
+struct trace_ring {
+	unsigned tr_total;	/* events ever recorded; next slot is % size */
+	struct trace_event tr_events[TRACE_RINGSIZE];
+};
+
+extern volatile bool trace_enabled;
+
+void trace_record(unsigned type, uint32_t a0, uint32_t a1, uint32_t a2);
+
+#define TRACE(type, a0, a1, a2) \
+	do { \
+		if (trace_enabled) { \
+			trace_record(type, a0, a1, a2); \
+		} \
+	} while (0)
+
+/*
+ * Control, for the kernel menu.
+ *
+ *    trace_start - throw away old events and start tracing.
+ *                  Returns ENOMEM if the rings can't be allocated.
+ *    trace_stop  - stop tracing; events are kept.
+ *    trace_save  - write the events to PATH.
+ */
+int trace_start(void);
+void trace_stop(void);
+int trace_save(const char *path);
+
+#endif /* _TRACE_H_ */
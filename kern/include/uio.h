@@ -138,5 +138,14 @@ int uiomovezeros(size_t len, struct uio *uio);
 void uio_kinit(struct iovec *, struct uio *,
 	       void *kbuf, size_t len, off_t pos, enum uio_rw rw);
 
+/*
+ * Initialize a uio for user I/O on an array of IOVCNT iovecs that has
+ * already been copied into the kernel, as readv and writev do. The
+ * iovecs themselves are consumed by uiomove. Fails with EINVAL if the
+ * total length doesn't fit in an ssize_t.
+ */
+int uio_uinit(struct iovec *iov, unsigned iovcnt, struct uio *u,
+	      off_t pos, enum uio_rw rw);
+
 
 #endif /* _UIO_H_ */
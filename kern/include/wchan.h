@@ -36,6 +36,7 @@
 
 
 struct spinlock; /* in spinlock.h */
+struct thread; /* in thread.h */
 struct wchan; /* Opaque */
 
 /*
@@ -66,6 +67,13 @@ bool wchan_isempty(struct wchan *wc, struct spinlock *lk);
  */
 void wchan_sleep(struct wchan *wc, struct spinlock *lk);
 
+/*
+ * Like wchan_sleep, but if nobody wakes the thread within TICKS
+ * hardclocks, wake up anyway. Returns 0 if woken by wchan_wake*,
+ * ETIMEDOUT if the time ran out.
+ */
+int wchan_sleep_timeout(struct wchan *wc, struct spinlock *lk, unsigned ticks);
+
 /*
  * Wake up one thread, or all threads, sleeping on a wait channel.
  * The associated spinlock should be locked.
@@ -76,5 +84,13 @@ void wchan_sleep(struct wchan *wc, struct spinlock *lk);
 void wchan_wakeone(struct wchan *wc, struct spinlock *lk);
 void wchan_wakeall(struct wchan *wc, struct spinlock *lk);
 
+/*
+ * Wake up TARGET if it is sleeping on the channel, for callers that
+ * keep their own list of who is waiting for what. Returns false if
+ * TARGET was not on the channel (it has already been woken).
+ */
+bool wchan_wakethread(struct wchan *wc, struct thread *target,
+		      struct spinlock *lk);
+
 
 #endif /* _WCHAN_H_ */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _WORKQUEUE_H_
+#define _WORKQUEUE_H_
+
+/*
+ * Deferred work.
+ *
+ * workqueue_enqueue(func, arg) arranges for func(arg) to be called
+ * soon by a kernel worker thread, so that expensive cleanup (freeing
+ * an address space, destroying an exited process) need not hold up
+ * the thread that made it unnecessary.
+ *
+ * Each CPU has its own queue and a worker thread bound to that CPU;
+ * work goes on the queue of the CPU that enqueues it. The worker
+ * takes everything queued at once and runs it as a batch, and it is
+ * only woken when work arrives on an empty queue, so a burst of
+ * enqueues costs one wakeup.
+ *
+ * Work functions run in an ordinary kernel thread and may sleep.
+ * There is no ordering between items on different CPUs.
+ *
+ * If there are no workers yet (early boot) or a queue entry can't be
+ * allocated, workqueue_enqueue just calls func(arg) itself, so callers
+ * must be able to cope with that.
+ */
+
+#include <spinlock.h>
+
+struct cpu;
+struct wchan;
+
+struct workitem {
+	struct workitem *wi_next;
+	void (*wi_func)(void *);
+	void *wi_arg;
+};
+
+struct workqueue {
+	struct spinlock wq_lock;
+	struct wchan *wq_wchan;		/* worker sleeps here; NULL until started */
+	struct workitem *wq_head;	/* pending items, oldest first */
+	struct workitem **wq_tailp;
+	unsigned wq_pending;		/* items on the list */
+	unsigned wq_batches;		/* batches run, for statistics */
+	unsigned wq_done;		/* items run, for statistics */
+};
+
+/* Per-cpu setup; workqueue_start forks the worker bound to C. */
+void workqueue_init(struct workqueue *wq);
+void workqueue_start(struct cpu *c);
+
+void workqueue_enqueue(void (*func)(void *), void *arg);
+
+#endif /* _WORKQUEUE_H_ */
@@ -60,3 +60,25 @@ strerror(int errcode)
 	panic("Invalid error code %d\n", errcode);
 	return NULL;
 }
+
+/*
+ * Sort an array of N uint32_t into ascending order, in place.
+ * Shell sort: no recursion or scratch memory, and quick enough for
+ * the few thousand samples the profiler and benchmarks collect.
+ */
+void
+sort_uint32(uint32_t *a, unsigned n)
+{
+	unsigned gap, i, j;
+	uint32_t tmp;
+
+	for (gap = n/2; gap > 0; gap /= 2) {
+		for (i = gap; i < n; i++) {
+			tmp = a[i];
+			for (j = i; j >= gap && a[j-gap] > tmp; j -= gap) {
+				a[j] = a[j-gap];
+			}
+			a[j] = tmp;
+		}
+	}
+}
@@ -28,6 +28,7 @@
  */
 
 #include <types.h>
+#include <kern/errno.h>
 #include <lib.h>
 #include <uio.h>
 #include <proc.h>
@@ -163,3 +164,32 @@ uio_kinit(struct iovec *iov, struct uio *u,
 	u->uio_rw = rw;
 	u->uio_space = NULL;
 }
+
+/*
+ * Convenience function to initialize a uio for user I/O on an iovec
+ * array.
+ */
+int
+uio_uinit(struct iovec *iov, unsigned iovcnt, struct uio *u,
+	  off_t pos, enum uio_rw rw)
+{
+	size_t resid = 0;
+	unsigned i;
+
+	for (i=0; i<iovcnt; i++) {
+		/* The total has to be representable as a return value */
+		if (iov[i].iov_len > ((size_t)-1 >> 1) - resid) {
+			return EINVAL;
+		}
+		resid += iov[i].iov_len;
+	}
+
+	u->uio_iov = iov;
+	u->uio_iovcnt = iovcnt;
+	u->uio_offset = pos;
+	u->uio_resid = resid;
+	u->uio_segflg = UIO_USERSPACE;
+	u->uio_rw = rw;
+	u->uio_space = proc_getas();
+	return 0;
+}
@@ -31,6 +31,7 @@
 #include <kern/errno.h>
 #include <kern/reboot.h>
 #include <kern/unistd.h>
+#include <kern/wait.h>
 #include <limits.h>
 #include <lib.h>
 #include <uio.h>
@@ -41,6 +42,9 @@
 #include <sfs.h>
 #include <syscall.h>
 #include <test.h>
+#include <lockstat.h>
+#include <prof.h>
+#include <trace.h>
 #include "opt-synchprobs.h"
 #include "opt-sfs.h"
 #include "opt-net.h"
@@ -93,7 +97,8 @@ cmd_progthread(void *ptr, unsigned long nargs)
 	if (result) {
 		kprintf("Running program %s failed: %s\n", args[0],
 			strerror(result));
-		return;
+		/* Let the menu's waitpid collect us */
+		proc_exit(_MKWAIT_EXIT(1));
 	}
 
 	/* NOTREACHED: runprogram only returns on error. */
@@ -129,15 +134,14 @@ common_prog(int nargs, char **args)
 		return ENOMEM;
 	}
 
-	kproc->p_num_children_running += 1;
-
-	unsigned index;
-	lock_acquire(kproc->p_parent_lock);
-	array_add(kproc->p_child_process_arr, (void *) proc, &index);
-	lock_release(kproc->p_parent_lock);
-
-	/* Tell child what it's index is in parent's array */
-    proc->p_child_index = index;
+	/* The menu (kproc) is the parent, so it can wait for the program */
+	lock_acquire(proc_family_lock);
+	result = proc_addchild(kproc, proc);
+	lock_release(proc_family_lock);
+	if (result) {
+		proc_destroy(proc);
+		return result;
+	}
 
 	result = thread_fork(args[0] /* thread name */,
 			proc /* new process */,
@@ -145,6 +149,9 @@ common_prog(int nargs, char **args)
 			args /* thread arg */, nargs /* thread arg */);
 	if (result) {
 		kprintf("thread_fork failed: %s\n", strerror(result));
+		lock_acquire(proc_family_lock);
+		proc_remchild(kproc, proc);
+		lock_release(proc_family_lock);
 		proc_destroy(proc);
 		return result;
 	}
@@ -154,23 +161,9 @@ common_prog(int nargs, char **args)
 	 * once you write the code for handling that.
 	 */
 
-	/* waitpid on the process */
-	int status;
+	/* waitpid on the process; this also destroys it */
 	int ret_pid;
-	int ret_val = sys_waitpid(proc->p_process_id, &status, 0, &ret_pid);
-
-	lock_acquire(kproc->p_parent_lock);
-	proc_destroy(proc);
-	array_remove(kproc->p_child_process_arr, index);
-	unsigned num_children_tracked = array_num(kproc->p_child_process_arr);
-
-	for (unsigned j = index; j < num_children_tracked; j++) {
-		struct proc *cur_child = array_get(kproc->p_child_process_arr, j);
-
-		/* Update the p_child_index since the remove shifts the array */
-		cur_child->p_child_index -= 1;
-	}
-	lock_release(kproc->p_parent_lock);
+	int ret_val = sys_waitpid(proc->p_process_id, NULL, 0, &ret_pid);
 
 	/* No more processes running, can return to menu */
 	(void) ret_val;
@@ -442,6 +435,115 @@ cmd_kheapdump(int nargs, char **args)
 	return 0;
 }
 
+/*
+ * Command for printing per-cpu context switch counts.
+ */
+static
+int
+cmd_cpustats(int nargs, char **args)
+{
+	(void)nargs;
+	(void)args;
+
+	thread_printstats();
+
+	return 0;
+}
+
+/*
+ * Command for the lock contention profiler.
+ */
+static
+int
+cmd_lockstat(int nargs, char **args)
+{
+	if (nargs == 1) {
+		lockstat_dump();
+	}
+	else if (nargs == 2 && !strcmp(args[1], "on")) {
+		lockstat_start();
+	}
+	else if (nargs == 2 && !strcmp(args[1], "off")) {
+		lockstat_stop();
+	}
+	else if (nargs == 2 && !strcmp(args[1], "reset")) {
+		lockstat_reset();
+	}
+	else {
+		kprintf("Usage: lockstat [on|off|reset]\n");
+	}
+
+	return 0;
+}
+
+/*
+ * Command for the sampling profiler.
+ */
+static
+int
+cmd_prof(int nargs, char **args)
+{
+	unsigned nfuncs;
+	int result = 0;
+
+	if (nargs == 2 && !strcmp(args[1], "on")) {
+		result = prof_start();
+	}
+	else if (nargs == 2 && !strcmp(args[1], "off")) {
+		prof_stop();
+	}
+	else if (nargs == 1 ||
+		 (nargs <= 4 && !strcmp(args[1], "dump"))) {
+		nfuncs = nargs >= 3 ? (unsigned)atoi(args[2]) : 20;
+		if (nfuncs == 0) {
+			nfuncs = 20;
+		}
+		prof_dump(nfuncs, nargs == 4 ? args[3] : PROF_DEFAULT_KERNEL);
+	}
+	else if (nargs == 3 && !strcmp(args[1], "save")) {
+		result = prof_save(args[2]);
+	}
+	else {
+		kprintf("Usage: prof [on|off|dump [nfuncs [kernel]]|"
+			"save file]\n");
+		return 0;
+	}
+
+	if (result) {
+		kprintf("prof: %s\n", strerror(result));
+	}
+	return 0;
+}
+
+/*
+ * Command for event tracing.
+ */
+static
+int
+cmd_trace(int nargs, char **args)
+{
+	int result = 0;
+
+	if (nargs == 2 && !strcmp(args[1], "on")) {
+		result = trace_start();
+	}
+	else if (nargs == 2 && !strcmp(args[1], "off")) {
+		trace_stop();
+	}
+	else if (nargs == 3 && !strcmp(args[1], "save")) {
+		result = trace_save(args[2]);
+	}
+	else {
+		kprintf("Usage: trace [on|off|save file]\n");
+		return 0;
+	}
+
+	if (result) {
+		kprintf("trace: %s\n", strerror(result));
+	}
+	return 0;
+}
+
 ////////////////////////////////////////
 //
 // Menus.
@@ -515,6 +617,10 @@ static const char *testmenu[] = {
 	"[sy2] Lock test             (1)     ",
 	"[sy3] CV test               (1)     ",
 	"[sy4] CV test #2            (1)     ",
+	"[sy5] RW lock test          (1)     ",
+	"[sy6] CV timed wait test    (1)     ",
+	"[sy7] Spinlock benchmark            ",
+	"[lb1] Lock wait-time benchmark      ",
 	"[fs1] Filesystem test               ",
 	"[fs2] FS read stress                ",
 	"[fs3] FS write stress               ",
@@ -548,6 +654,10 @@ static const char *mainmenu[] = {
 	"[kh] Kernel heap stats              ",
 	"[khgen] Next kernel heap generation ",
 	"[khdump] Dump kernel heap           ",
+	"[lockstat] Lock contention stats    ",
+	"[prof] Sampling profiler            ",
+	"[trace] Event tracing               ",
+	"[cpus] Context switch stats         ",
 	"[q] Quit and shut down              ",
 	NULL
 };
@@ -602,6 +712,10 @@ static struct {
 	{ "kh",         cmd_kheapstats },
 	{ "khgen",      cmd_kheapgeneration },
 	{ "khdump",     cmd_kheapdump },
+	{ "lockstat",   cmd_lockstat },
+	{ "prof",       cmd_prof },
+	{ "trace",      cmd_trace },
+	{ "cpus",       cmd_cpustats },
 
 	/* base system tests */
 	{ "at",		arraytest },
@@ -623,6 +737,10 @@ static struct {
 	{ "sy2",	locktest },
 	{ "sy3",	cvtest },
 	{ "sy4",	cvtest2 },
+	{ "sy5",	rwtest },
+	{ "sy6",	timedwaittest },
+	{ "sy7",	spintest },
+	{ "lb1",	lockbench },
 
 	/* file system assignment tests */
 	{ "fs1",	fstest },
@@ -49,47 +49,82 @@
 #include <addrspace.h>
 #include <vnode.h>
 #include <kern/fcntl.h>
-#include <fd.h>
+#include <filetable.h>
 #include <limits.h>
 #include <synch.h>
+#include <workqueue.h>
 
-/* 
+/*
  * The process ID table (PID table)
- * This holds all the process IDs that are in use.
- * The index is equal to the process ID
- * The value at a given index represents whether it is allocated or not.
- * 0 means the process ID is not allocated.
- * 1 means the process ID is allocated.
- * Indexes 0 and 1 are not valid Process IDs. These will be initialized with a value of 1.
+ * This maps every process ID in use to its process, so any process can
+ * be found from its PID in constant time. The index is the process ID.
+ *
+ * The free PIDs are kept on a FIFO list threaded through the free
+ * slots themselves: a free slot holds the next free PID, shifted up
+ * one bit with the low bit set so it can't be mistaken for a (word
+ * aligned) proc pointer. Allocating takes the PID at the head of the
+ * list and freeing puts the PID at the tail, so both are O(1), and a
+ * PID that was just freed is the last one to be handed out again
+ * rather than the first. PID_MAX leaves no room to encode a generation
+ * count in the PID itself; cycling through the whole free list before
+ * reuse serves the same purpose of keeping stale PIDs from matching.
+ *
+ * Slots 0 and 1 (the invalid PID and the kernel's) are never free.
+ * PID 0 also marks the end of the free list.
  */
-uint8_t process_ID_table[PID_MAX + 1] = {0}; // Plus 1 to account for 0-index.
+static uintptr_t process_ID_table[PID_MAX + 1];
 
-struct lock *pid_table_lock;
+#define PID_SLOT_FREE(next)     (((uintptr_t)(next) << 1) | 1)
+#define PID_SLOT_ISFREE(slot)   (((slot) & 1) != 0)
+#define PID_SLOT_NEXT(slot)     ((pid_t)((slot) >> 1))
+
+static pid_t pid_free_head;		/* next PID to hand out; 0 if none */
+static pid_t pid_free_tail;		/* last free PID */
+
+/*
+ * Protects the table and the free list. Everything done under it is
+ * constant time, so a spinlock will do.
+ */
+static struct spinlock pid_table_lock = SPINLOCK_INITIALIZER;
 
 /*
  * The process for the kernel; this holds all the kernel-only threads.
  */
 struct proc *kproc;
 
+/*
+ * One lock for the whole process tree. With a lock per parent, a child
+ * exiting would have to lock a parent that might be exiting and being
+ * destroyed at the same time; with one lock, a parent can orphan its
+ * children and they can never see it half gone. Everything done under
+ * it is constant time per process involved.
+ */
+struct lock *proc_family_lock;
+
 /* 
- * Get a new process ID. Returns the lowest available process ID.
+ * Get a new process ID for PROC and enter PROC in the PID table.
+ * Returns 0 if all process IDs are in use.
  */
 pid_t 
-get_process_id() 
+get_process_id(struct proc *proc) 
 {
-    pid_t current_pid;
+	pid_t pid;
 
-	lock_acquire(pid_table_lock);
+	KASSERT(proc != NULL);
 
-	for (current_pid = PID_MIN; current_pid <= PID_MAX; current_pid++) {
-        if (process_ID_table[current_pid] == 0) {
-			process_ID_table[current_pid] = 1; // Now in use
-			lock_release(pid_table_lock);
-			return current_pid;
+	spinlock_acquire(&pid_table_lock);
+	pid = pid_free_head;
+	if (pid != 0) {
+		KASSERT(PID_SLOT_ISFREE(process_ID_table[pid]));
+		pid_free_head = PID_SLOT_NEXT(process_ID_table[pid]);
+		if (pid_free_head == 0) {
+			pid_free_tail = 0;
 		}
+		process_ID_table[pid] = (uintptr_t)proc; // Now in use
 	}
-	lock_release(pid_table_lock);
-	return 0;
+	spinlock_release(&pid_table_lock);
+
+	return pid;
 }
 
 /* 
@@ -103,9 +138,23 @@ dealloc_process_id(pid_t pid_to_dealloc)
 		return -1;
 	}
 
-	lock_acquire(pid_table_lock);
-	process_ID_table[pid_to_dealloc] = 0; // Deallocate the PID.
-	lock_release(pid_table_lock);
+	spinlock_acquire(&pid_table_lock);
+	if (PID_SLOT_ISFREE(process_ID_table[pid_to_dealloc])) {
+		/* Not allocated */
+		spinlock_release(&pid_table_lock);
+		return -1;
+	}
+
+	/* Put it at the back of the free list */
+	process_ID_table[pid_to_dealloc] = PID_SLOT_FREE(0);
+	if (pid_free_tail == 0) {
+		pid_free_head = pid_to_dealloc;
+	}
+	else {
+		process_ID_table[pid_free_tail] = PID_SLOT_FREE(pid_to_dealloc);
+	}
+	pid_free_tail = pid_to_dealloc;
+	spinlock_release(&pid_table_lock);
 
 	/* Success */
 	return 0;
@@ -117,17 +166,144 @@ dealloc_process_id(pid_t pid_to_dealloc)
 uint8_t
 get_pid_status(pid_t pid)
 {
+	uint8_t pid_status;
+
 	if (pid < PID_MIN || pid > PID_MAX) {
         return 2;
     }
 
-	lock_acquire(pid_table_lock);
-	uint8_t pid_status = process_ID_table[pid];
-	lock_release(pid_table_lock);
+	spinlock_acquire(&pid_table_lock);
+	pid_status = PID_SLOT_ISFREE(process_ID_table[pid]) ? 0 : 1;
+	spinlock_release(&pid_table_lock);
 
 	return pid_status;
 }
 
+/*
+ * Find the child of PARENT with process ID PID. Returns NULL if
+ * PARENT has no such child.
+ *
+ * Children are only destroyed by their parent, so the result stays
+ * valid for as long as the caller is running in PARENT. The PID table
+ * lock keeps the process from going away while we check its parent.
+ */
+struct proc *
+proc_find_child(struct proc *parent, pid_t pid)
+{
+	struct proc *found = NULL;
+	uintptr_t slot;
+
+	if (pid < PID_MIN || pid > PID_MAX) {
+		return NULL;
+	}
+
+	spinlock_acquire(&pid_table_lock);
+	slot = process_ID_table[pid];
+	if (!PID_SLOT_ISFREE(slot)) {
+		found = (struct proc *)slot;
+		if (found->p_parent_process != parent) {
+			found = NULL;
+		}
+	}
+	spinlock_release(&pid_table_lock);
+
+	return found;
+}
+
+
+/*
+ * A parent's children array is kept with the zombies first: slots
+ * [0, nzombies) hold children that have exited and not been reaped,
+ * and the rest hold live ones, where nzombies is the array size minus
+ * p_num_children_running. Each child knows its own index. That way
+ * adding, removing, finding any zombie, and turning a live child into
+ * a zombie are all constant time.
+ */
+static
+unsigned
+proc_numzombies(struct proc *parent)
+{
+	return array_num(parent->p_child_process_arr) - parent->p_num_children_running;
+}
+
+static
+void
+proc_swapchildren(struct proc *parent, unsigned a, unsigned b)
+{
+	struct proc *pa, *pb;
+
+	if (a == b) {
+		return;
+	}
+	pa = array_get(parent->p_child_process_arr, a);
+	pb = array_get(parent->p_child_process_arr, b);
+	array_set(parent->p_child_process_arr, a, pb);
+	array_set(parent->p_child_process_arr, b, pa);
+	pb->p_child_index = a;
+	pa->p_child_index = b;
+}
+
+/*
+ * Add CHILD to PARENT's children, as a live child.
+ *
+ * The caller must hold proc_family_lock.
+ */
+int
+proc_addchild(struct proc *parent, struct proc *child)
+{
+	int result;
+
+	KASSERT(lock_do_i_hold(proc_family_lock));
+	KASSERT(!child->p_is_zombie);
+
+	result = array_add(parent->p_child_process_arr, child, &child->p_child_index);
+	if (result) {
+		return result;
+	}
+	child->p_parent_process = parent;
+	parent->p_num_children_running += 1;
+	return 0;
+}
+
+/*
+ * Remove CHILD from PARENT's children, live or zombie.
+ *
+ * The caller must hold proc_family_lock.
+ */
+void
+proc_remchild(struct proc *parent, struct proc *child)
+{
+	unsigned last = array_num(parent->p_child_process_arr) - 1;
+
+	KASSERT(lock_do_i_hold(proc_family_lock));
+	KASSERT(array_get(parent->p_child_process_arr, child->p_child_index) == child);
+
+	if (child->p_is_zombie) {
+		/* Move it to the end of the zombies, then fill its slot with the last child */
+		proc_swapchildren(parent, child->p_child_index, proc_numzombies(parent) - 1);
+	}
+	else {
+		parent->p_num_children_running -= 1;
+	}
+	proc_swapchildren(parent, child->p_child_index, last);
+	array_remove(parent->p_child_process_arr, last);
+}
+
+/*
+ * Return one of PARENT's zombie children, or NULL if none have exited.
+ *
+ * The caller must hold proc_family_lock.
+ */
+struct proc *
+proc_find_zombie(struct proc *parent)
+{
+	KASSERT(lock_do_i_hold(proc_family_lock));
+
+	if (proc_numzombies(parent) == 0) {
+		return NULL;
+	}
+	return array_get(parent->p_child_process_arr, 0);
+}
 
 /*
  * Create a proc structure.
@@ -158,37 +334,53 @@ proc_create(const char *name)
 	/* VFS fields */
 	proc->p_cwd = NULL;
 
-	/* FD Table */
-	proc->p_fd_table = fd_table_create();
-	if (proc->p_fd_table == NULL) {
-		return NULL;
-	}
+	/* File table */
+	proc->p_filetable = NULL;
 
     /* Child Process Array */
 	proc->p_child_process_arr = array_create();
 	if (proc->p_child_process_arr == NULL) {
-		return NULL;
+		goto fail_arr;
 	}
 
-	/* Lock for Child Process Structure */
-	proc->p_parent_lock = lock_create("child_arr_lock");
-	if (proc->p_parent_lock == NULL) {
-		return NULL;
+	/* CVs for the parent to wait on us, and for us to wait on any child; used with proc_family_lock */
+	proc->p_exit_cv = cv_create("exit_cv");
+	if (proc->p_exit_cv == NULL) {
+		goto fail_exit_cv;
 	}
-
-	/* CV for Parent */
-	proc->p_parent_cv = cv_create("parent_cv");
-	if (proc->p_parent_cv == NULL) {
-		return NULL;
+	proc->p_child_exit_cv = cv_create("child_exit_cv");
+	if (proc->p_child_exit_cv == NULL) {
+		goto fail_child_exit_cv;
 	}
 
+	proc->p_parent_process = NULL;
+	proc->p_child_index = 0;
+
+	proc->p_process_id = 0; // Assigned by get_process_id once the process is set up.
+
 	proc->p_exit_status = 0; // Initialized to 0. Only check exit status when p_is_zombie = 1
 
 	proc->p_is_zombie = 0;  // When it becomes a zombie, will be set to 1.
 
 	proc->p_num_children_running = 0; // Initialize number of children to 0.
 
+	proc->p_priority = 0; // Dynamic MLFQ scheduling until setpriority() pins it.
+	proc->p_cputime = 0;
+	proc->p_nvcsw = 0;
+	proc->p_nivcsw = 0;
+
 	return proc;
+
+fail_child_exit_cv:
+	cv_destroy(proc->p_exit_cv);
+fail_exit_cv:
+	array_destroy(proc->p_child_process_arr);
+fail_arr:
+	spinlock_cleanup(&proc->p_lock);
+	threadarray_cleanup(&proc->p_threads);
+	kfree(proc->p_name);
+	kfree(proc);
+	return NULL;
 }
 
 /*
@@ -223,14 +415,18 @@ proc_destroy(struct proc *proc)
 		proc->p_cwd = NULL;
 	}
 
-	/* FD Table */
-	fd_table_destroy(proc->p_fd_table);
+	/* File table */
+	if (proc->p_filetable) {
+		filetable_destroy(proc->p_filetable);
+		proc->p_filetable = NULL;
+	}
 
 	/* Deallocate PID */
 	dealloc_process_id(proc->p_process_id);
 
 	/* Destroy CV*/
-	cv_destroy(proc->p_parent_cv);
+	cv_destroy(proc->p_exit_cv);
+	cv_destroy(proc->p_child_exit_cv);
 
 	/* VM fields */
 	if (proc->p_addrspace) {
@@ -283,15 +479,8 @@ proc_destroy(struct proc *proc)
 	threadarray_cleanup(&proc->p_threads);
 	spinlock_cleanup(&proc->p_lock);
 
-	/* Empty array before destroying */
-	int index = array_num(proc->p_child_process_arr) - 1;
-	while (index > 0) {
-		struct proc *cur_child = array_get(proc->p_child_process_arr, index);
-		proc_destroy(cur_child);
-		array_remove(proc->p_child_process_arr, index);
-		index -= 1;
-	}
-	/* Array empty for sure */
+	/* Children were reaped or orphaned when we exited */
+	KASSERT(array_num(proc->p_child_process_arr) == 0);
 	array_destroy(proc->p_child_process_arr);
 
 	kfree(proc->p_name);
@@ -304,18 +493,11 @@ proc_destroy(struct proc *proc)
 void
 proc_bootstrap(void)
 {
-	/* 
-	 * Initialize Process ID Table 
-	 * Process IDs 0 and 1 are illegal
-	 * The first valid Process ID is 2 (see limits.h)
-	 */
-	process_ID_table[0] = 1; // Illegal Process ID.
-	process_ID_table[1] = 1; // Main Kernel Process ID.
+	pid_t pid;
 
-	/* Initialize PID Table Lock */
-	pid_table_lock = lock_create("pid_table_lock");
-	if (pid_table_lock == NULL) {
-		panic("lock_create for PID table failed\n");
+	proc_family_lock = lock_create("proc_family_lock");
+	if (proc_family_lock == NULL) {
+		panic("lock_create for proc_family_lock failed\n");
 	}
 
 	/* Create the kernel process */
@@ -324,6 +506,21 @@ proc_bootstrap(void)
 		panic("proc_create for kproc failed\n");
 	}
 	kproc->p_process_id = 1;
+
+	/* 
+	 * Initialize Process ID Table 
+	 * Process ID 0 is illegal and 1 is the kernel's.
+	 * The first valid Process ID is 2 (see limits.h); all of those
+	 * start out on the free list, in order.
+	 */
+	process_ID_table[0] = 0; // Illegal Process ID.
+	process_ID_table[1] = (uintptr_t)kproc; // Main Kernel Process ID.
+	for (pid = PID_MIN; pid < PID_MAX; pid++) {
+		process_ID_table[pid] = PID_SLOT_FREE(pid + 1);
+	}
+	process_ID_table[PID_MAX] = PID_SLOT_FREE(0);
+	pid_free_head = PID_MIN;
+	pid_free_tail = PID_MAX;
 }
 
 /*
@@ -360,61 +557,17 @@ proc_create_runprogram(const char *name)
 	}
 	spinlock_release(&curproc->p_lock);
 
-	/* 
-	 * Create File Descriptors for STDOUT, STDIN, and STDERR 
+	/*
+	 * The file table is left NULL: runprogram opens stdin, stdout
+	 * and stderr, and fork shares the parent's open files instead.
 	 */
-	char *filename;
-	filename = (char *) kmalloc(PATH_MAX);
-	if (filename == NULL) {
-		fd_table_destroy(newproc->p_fd_table);
-		proc_destroy(newproc);
-		return NULL;
-	}
-
-	int result;
-
-	/* STDOUT */
-	strcpy(filename, "con:");
-	struct fd fd_stdout;
-	int fd_stdout_num;
-	result = fd_create(filename, O_RDONLY, &fd_stdout, &fd_stdout_num, newproc->p_fd_table);
-	if (result != 0) {
-		fd_table_destroy(newproc->p_fd_table);
-		proc_destroy(newproc);
-		return NULL;
-	}
 
-	/* STDIN */
-	strcpy(filename, "con:");
-	struct fd fd_stdin;
-	int fd_stdin_num;
-	result = fd_create(filename, O_WRONLY, &fd_stdin, &fd_stdin_num, newproc->p_fd_table);
-	if (result != 0) {
-		fd_table_destroy(newproc->p_fd_table); // Will also de-allocate any FD's already created
-		proc_destroy(newproc);
-		return NULL;
-	}
-
-	/* STDERR */
-	strcpy(filename, "con:");
-	struct fd fd_stderr;
-	int fd_stderr_num;
-	result = fd_create(filename, O_WRONLY, &fd_stderr, &fd_stderr_num, newproc->p_fd_table);
-	if (result != 0) {
-		fd_table_destroy(newproc->p_fd_table); // Will also de-allocate any FD's already created
-		proc_destroy(newproc);
-		return NULL;
-	}
-
-	kfree(filename);
-
-	newproc->p_parent_process = curproc;
+	/* The parent is set when the caller adds us with proc_addchild */
 
 	/* Get a new process ID for the process */
-	pid_t new_process_id = get_process_id(); // Define new function
+	pid_t new_process_id = get_process_id(newproc);
 
 	if (new_process_id == 0) {
-		fd_table_destroy(newproc->p_fd_table); // Will also de-allocate any FD's already created
 		proc_destroy(newproc);
 		return NULL;
 	}
@@ -479,6 +632,10 @@ proc_remthread(struct thread *t)
 	for (i=0; i<num; i++) {
 		if (threadarray_get(&proc->p_threads, i) == t) {
 			threadarray_remove(&proc->p_threads, i);
+			/* Keep the thread's CPU accounting */
+			proc->p_cputime += t->t_cputime;
+			proc->p_nvcsw += t->t_nvcsw;
+			proc->p_nivcsw += t->t_nivcsw;
 			spinlock_release(&proc->p_lock);
 			spl = splhigh();
 			t->t_proc = NULL;
@@ -491,6 +648,31 @@ proc_remthread(struct thread *t)
 	panic("Thread (%p) has escaped from its process (%p)\n", t, proc);
 }
 
+/*
+ * Add up CPU time and context switches for a process: what its exited
+ * threads left behind plus what its live threads have used so far.
+ * The live threads' counters may be moving; this is only statistics.
+ */
+void
+proc_getusage(struct proc *proc, unsigned *cputime, unsigned *nvcsw, unsigned *nivcsw)
+{
+	struct thread *t;
+	unsigned i, num;
+
+	spinlock_acquire(&proc->p_lock);
+	*cputime = proc->p_cputime;
+	*nvcsw = proc->p_nvcsw;
+	*nivcsw = proc->p_nivcsw;
+	num = threadarray_num(&proc->p_threads);
+	for (i=0; i<num; i++) {
+		t = threadarray_get(&proc->p_threads, i);
+		*cputime += t->t_cputime;
+		*nvcsw += t->t_nvcsw;
+		*nivcsw += t->t_nivcsw;
+	}
+	spinlock_release(&proc->p_lock);
+}
+
 /*
  * Fetch the address space of (the current) process.
  *
@@ -533,3 +715,125 @@ proc_setas(struct addrspace *newas)
 	spinlock_release(&proc->p_lock);
 	return oldas;
 }
+
+/* Workqueue callbacks: the expensive parts of exiting, done off the critical path */
+static
+void
+proc_exit_destroy_as(void *as)
+{
+	as_destroy(as);
+}
+
+static
+void
+proc_exit_destroy_proc(void *proc)
+{
+	proc_destroy(proc);
+}
+
+/*
+ * Exit the current process, leaving WAITSTATUS for waitpid. Used by
+ * _exit and when a process is killed by a fatal trap.
+ *
+ * Zombie children are destroyed, since nobody can wait for them any
+ * more; live children are orphaned and will destroy themselves when
+ * they exit. If we have a parent, we become a zombie and wake it if
+ * it is waiting for us; otherwise we destroy ourselves. A zombie keeps
+ * only its proc structure and PID: the address space, open files and
+ * current directory are all released here rather than at reap time.
+ *
+ * Freeing the address space and destroying processes is handed to the
+ * workqueue, so neither the exiting process nor a parent blocked in
+ * waitpid waits on it. To make that safe, the thread detaches from its
+ * process before the process is published as a zombie; after that
+ * point nothing here touches curproc.
+ */
+void
+proc_exit(int waitstatus)
+{
+	struct proc *proc = curproc;
+	struct proc *parent;
+	struct proc *child;
+	struct addrspace *as;
+	struct vnode *cwd;
+	unsigned num;
+
+	KASSERT(proc != NULL && proc != kproc);
+
+	/* We never return to user mode, so the address space can go right away */
+	as = proc_setas(NULL);
+	as_deactivate();
+	if (as != NULL) {
+		workqueue_enqueue(proc_exit_destroy_as, as);
+	}
+
+	/* Nothing can use these once we're on the way out */
+	if (proc->p_filetable != NULL) {
+		filetable_destroy(proc->p_filetable);
+		proc->p_filetable = NULL;
+	}
+	spinlock_acquire(&proc->p_lock);
+	cwd = proc->p_cwd;
+	proc->p_cwd = NULL;
+	spinlock_release(&proc->p_lock);
+	if (cwd != NULL) {
+		VOP_DECREF(cwd);
+	}
+
+	lock_acquire(proc_family_lock);
+
+	/* Let go of all our children; removing from the end is cheap */
+	while ((num = array_num(proc->p_child_process_arr)) > 0) {
+		child = array_get(proc->p_child_process_arr, num - 1);
+		proc_remchild(proc, child);
+		if (child->p_is_zombie) {
+			/* It detached its thread before becoming a zombie */
+			workqueue_enqueue(proc_exit_destroy_proc, child);
+		}
+		else {
+			child->p_parent_process = NULL;
+		}
+	}
+
+	proc->p_exit_status = waitstatus;
+
+	/* Detach from the process before anyone can see it as a zombie */
+	proc_remthread(curthread);
+
+	parent = proc->p_parent_process;
+	if (parent == NULL) {
+		/* Orphaned; nobody will wait for us */
+		proc->p_is_zombie = 1;
+		workqueue_enqueue(proc_exit_destroy_proc, proc);
+	}
+	else {
+		/* Move to the zombie end of the parent's children */
+		proc_swapchildren(parent, proc->p_child_index, proc_numzombies(parent));
+		parent->p_num_children_running -= 1;
+		proc->p_is_zombie = 1;
+
+		/* Wake our parent if it's waiting for us, or for any child */
+		cv_signal(proc->p_exit_cv, proc_family_lock);
+		cv_signal(parent->p_child_exit_cv, proc_family_lock);
+	}
+
+	lock_release(proc_family_lock);
+
+	thread_exit();
+}
+
+/*
+ * Reap CHILD, a zombie child of PARENT whose exit status has been
+ * collected: drop it from PARENT's children and hand its destruction
+ * to the workqueue, as proc_exit does, so waitpid can return at once.
+ */
+void
+proc_reap(struct proc *parent, struct proc *child)
+{
+	lock_acquire(proc_family_lock);
+	KASSERT(child->p_is_zombie);
+	proc_remchild(parent, child);
+	lock_release(proc_family_lock);
+
+	workqueue_enqueue(proc_exit_destroy_proc, child);
+}
@@ -37,12 +37,13 @@
 #include <lib.h>
 #include <synch.h>
 #include <vfs.h>
+#include <vnode.h>
 #include <openfile.h>
 
 /*
- * Constructor for struct openfile.
+ * Constructor for struct openfile. Takes over the caller's reference
+ * to VN, which openfile_destroy gives back with vfs_close.
  */
-static
 struct openfile *
 openfile_create(struct vnode *vn, int accmode)
 {
@@ -64,10 +65,12 @@ openfile_create(struct vnode *vn, int accmode)
 		return NULL;
 	}
 
+	spinlock_init(&file->of_streamlock);
 	spinlock_init(&file->of_reflock);
 
 	file->of_vnode = vn;
 	file->of_accmode = accmode;
+	file->of_seekable = VOP_ISSEEKABLE(vn);
 	file->of_offset = 0;
 	file->of_refcount = 1;
 
@@ -86,6 +89,7 @@ openfile_destroy(struct openfile *file)
 	vfs_close(file->of_vnode);
 
 	spinlock_cleanup(&file->of_reflock);
+	spinlock_cleanup(&file->of_streamlock);
 	lock_destroy(file->of_offsetlock);
 	kfree(file);
 }
@@ -116,6 +120,43 @@ openfile_open(char *filename, int openflags, mode_t mode,
 	return 0;
 }
 
+/*
+ * Begin I/O through the shared seek position; see openfile.h.
+ */
+off_t
+openfile_startio(struct openfile *file)
+{
+	off_t pos;
+
+	if (file->of_seekable) {
+		lock_acquire(file->of_offsetlock);
+		return file->of_offset;
+	}
+
+	spinlock_acquire(&file->of_streamlock);
+	pos = file->of_offset;
+	spinlock_release(&file->of_streamlock);
+	return pos;
+}
+
+/*
+ * Finish I/O through the shared seek position.
+ */
+void
+openfile_endio(struct openfile *file, off_t start, off_t end)
+{
+	if (file->of_seekable) {
+		file->of_offset = end;
+		lock_release(file->of_offsetlock);
+		return;
+	}
+
+	/* Others may have moved it meanwhile; just add what we used */
+	spinlock_acquire(&file->of_streamlock);
+	file->of_offset += end - start;
+	spinlock_release(&file->of_streamlock);
+}
+
 /*
  * Increment the reference count on an openfile.
  */
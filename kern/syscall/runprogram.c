@@ -49,7 +49,8 @@
 #include <filetable.h>
 #include <syscall.h>
 #include <test.h>
-#include <fd.h>
+#include <openfile.h>
+#include <filetable.h>
 
 /*
  * argv buffer.
@@ -73,16 +74,39 @@ struct argbuf {
 #define EXEC_BIGBUF_THROTTLE	1
 static struct semaphore *execthrottle;
 
+/*
+ * The console open files used for stdin, stdout, and stderr. These
+ * are opened once, here, and every new process gets references to
+ * them instead of opening the console itself. (The console isn't
+ * seekable, so sharing the offset doesn't matter.)
+ */
+static struct openfile *console_stdfds[3];
+
 /*
  * Set things up.
  */
 void
 exec_bootstrap(void)
 {
+	static const int stdflags[3] = { O_RDONLY, O_WRONLY, O_WRONLY };
+	char path[8];
+	int fd, result;
+
 	execthrottle = sem_create("exec", EXEC_BIGBUF_THROTTLE);
 	if (execthrottle == NULL) {
 		panic("Cannot create exec throttle semaphore\n");
 	}
+
+	for (fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++) {
+		/* vfs_open destroys the path, so use a fresh copy each time */
+		strcpy(path, "con:");
+		result = openfile_open(path, stdflags[fd], 0664,
+				       &console_stdfds[fd]);
+		if (result) {
+			panic("Cannot open console for fd %d: %s\n",
+			      fd, strerror(result));
+		}
+	}
 }
 
 /*
@@ -408,70 +432,25 @@ loadexec(char *path, vaddr_t *entrypoint, vaddr_t *stackptr)
 
 
 /*
- * Open a file on a selected file descriptor. Takes care of various
- * minutiae, like the vfs-level open destroying pathnames.
- */
-static
-int
-placed_open(const char *path, int openflags, int fd)
-{
-	// struct openfile *newfile, *oldfile;
-	struct fd newfile;
-	char mypath[32];
-	int result;
-
-	/*
-	 * The filename comes from the kernel, in fact right in this
-	 * file; assume reasonable length. But make sure we fit.
-	 */
-	KASSERT(strlen(path) < sizeof(mypath));
-	strcpy(mypath, path);
-
-
-	// result = openfile_open(mypath, openflags, 0664, &newfile);
-    result = fd_create_at_pos(mypath, openflags, &newfile, fd, curproc->p_fd_table);
-	if (result) {
-		return result;
-	}
-
-	/* place the file in the filetable in the right slot */
-	// fd_table_placeat(curproc->p_fd_table, newfile, fd, &oldfile);
-
-	/* the table should previously have been empty */
-	// KASSERT(&oldfile == NULL);
-
-	return 0;
-}
-
-/*
- * Open the standard file descriptors: stdin, stdout, stderr.
- *
- * Note that if we fail part of the way through we can leave the fds
- * we've already opened in the file table and they'll get cleaned up
- * by process exit.
+ * Install the standard file descriptors: stdin, stdout, stderr. These
+ * are references to the console files opened by exec_bootstrap, so
+ * this can't fail.
  */
 static
-int
-open_stdfds(const char *inpath, const char *outpath, const char *errpath)
+void
+open_stdfds(void)
 {
-	int result;
-
-	result = placed_open(inpath, O_RDONLY, STDIN_FILENO);
-	if (result) {
-		return result;
-	}
+	struct openfile *oldfile;
+	int fd;
 
-	result = placed_open(outpath, O_WRONLY, STDOUT_FILENO);
-	if (result) {
-		return result;
-	}
+	for (fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++) {
+		openfile_incref(console_stdfds[fd]);
+		filetable_placeat(curproc->p_filetable, console_stdfds[fd],
+				  fd, &oldfile);
 
-	result = placed_open(errpath, O_WRONLY, STDERR_FILENO);
-	if (result) {
-		return result;
+		/* the table should previously have been empty */
+		KASSERT(oldfile == NULL);
 	}
-
-	return 0;
 }
 
 /*
@@ -499,16 +478,13 @@ runprogram(char *progname)
 	KASSERT(proc_getas() == NULL);
 
 	/* Set up stdin/stdout/stderr if necessary. */
-	if (curproc->p_fd_table == NULL) {
-		curproc->p_fd_table = fd_table_create();
-		if (curproc->p_fd_table == NULL) {
+	if (curproc->p_filetable == NULL) {
+		curproc->p_filetable = filetable_create();
+		if (curproc->p_filetable == NULL) {
 			return ENOMEM;
 		}
 
-		result = open_stdfds("con:", "con:", "con:");
-		if (result) {
-			return result;
-		}
+		open_stdfds();
 	}
 
 	/*
@@ -7,7 +7,6 @@
 #include <uio.h>
 #include <vfs.h>
 #include <addrspace.h>
-#include <fd.h>
 
 
 /* 
@@ -4,7 +4,8 @@
 #include <kern/errno.h>
 #include <current.h>
 #include <proc.h>
-#include <fd.h>
+#include <openfile.h>
+#include <filetable.h>
 
 /* 
  * Close system call
@@ -19,26 +20,24 @@
  */
 int sys_close(int fd)
 {
+    struct filetable *ft = curproc->p_filetable;
+    struct openfile *oldfile;
 
-    if (fd < 0 || fd >= OPEN_MAX) {
+    if (!filetable_okfd(ft, fd)) {
         // Not a valid file descriptor
         return EBADF;
     }
-    
-    struct fd_table *cur_fd_table = curproc->p_fd_table;
 
-    lock_acquire(cur_fd_table->fd_table_lock);
-    
-    if (cur_fd_table->all_fds[fd] == NULL) {
-        // Not a valid file descriptor, file is not open
-        lock_release(cur_fd_table->fd_table_lock);
+    /* 
+     * Empty the slot and drop its reference; the last one closes the file.
+     * Anyone still using the file through filetable_get has their own reference.
+     */
+    filetable_placeat(ft, NULL, fd, &oldfile);
+    if (oldfile == NULL) {
+        // File is not open
         return EBADF;
     }
-
-    lock_release(cur_fd_table->fd_table_lock);
-
-    /* Close the file */
-    fd_destroy(fd, cur_fd_table);
+    openfile_decref(oldfile);
 
     return 0;
 }
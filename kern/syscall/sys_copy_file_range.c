@@ -0,0 +1,263 @@
+#include <types.h>
+#include <copyinout.h>
+#include <syscall.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <current.h>
+#include <proc.h>
+#include <vnode.h>
+#include <uio.h>
+#include <kern/fcntl.h>
+#include <openfile.h>
+#include <filetable.h>
+
+/*
+ * Size of the kernel bounce buffer. A multiple of the filesystem block
+ * size, so that once the offsets are aligned every chunk goes straight
+ * through whole-block I/O with no partial-block read-modify-write.
+ */
+#define COPY_CHUNK 4096
+
+
+/*
+ * Begin and end I/O through the shared seek position of FILE, if the
+ * caller passed no explicit position for it. See openfile_startio.
+ */
+static
+void
+copy_startio(struct openfile *file, userptr_t upos, off_t *pos)
+{
+    if (upos == NULL) {
+        *pos = openfile_startio(file);
+    }
+}
+
+static
+void
+copy_endio(struct openfile *file, userptr_t upos, off_t start, off_t end)
+{
+    if (upos == NULL) {
+        openfile_endio(file, start, end);
+    }
+}
+
+/*
+ * Fetch the user-supplied starting position for one side of the copy,
+ * if there is one. (Otherwise copy_startio already provided it.)
+ */
+static
+int
+copy_getpos(struct openfile *file, userptr_t upos, off_t *pos)
+{
+    int result;
+
+    if (upos == NULL) {
+        return 0;
+    }
+    if (!file->of_seekable) {
+        return ESPIPE;
+    }
+    result = copyin((const_userptr_t) upos, pos, sizeof(off_t));
+    if (result) {
+        return result;
+    }
+    if (*pos < 0) {
+        return EINVAL;
+    }
+    return 0;
+}
+
+/*
+ * Store the final position for one side of the copy back to the user,
+ * if it came from there. (Otherwise copy_endio stores it.)
+ */
+static
+int
+copy_setpos(userptr_t upos, off_t pos)
+{
+    if (upos == NULL) {
+        return 0;
+    }
+    return copyout(&pos, upos, sizeof(off_t));
+}
+
+/*
+ * Move up to LEN bytes from INFILE at *INPOS to OUTFILE at *OUTPOS,
+ * advancing both positions. Stops early at end of input or on a short
+ * write; returns the byte count in *COPIED. If an error occurs after
+ * some data has moved, the partial count wins and the error is dropped,
+ * as it would be for a short read or write.
+ */
+static
+int
+copy_data(struct openfile *infile, off_t *inpos,
+          struct openfile *outfile, off_t *outpos,
+          size_t len, size_t *copied)
+{
+    struct iovec iov;
+    struct uio ku;
+    char *buf;
+    size_t chunk, got, put;
+    int result = 0;
+
+    *copied = 0;
+
+    buf = kmalloc(COPY_CHUNK);
+    if (buf == NULL) {
+        return ENOMEM;
+    }
+
+    while (*copied < len) {
+        /*
+         * Size the first chunk so the input reaches a chunk boundary;
+         * after that every read is whole blocks.
+         */
+        chunk = COPY_CHUNK - (size_t)(*inpos % COPY_CHUNK);
+        if (chunk > len - *copied) {
+            chunk = len - *copied;
+        }
+
+        uio_kinit(&iov, &ku, buf, chunk, *inpos, UIO_READ);
+        result = VOP_READ(infile->of_vnode, &ku);
+        if (result) {
+            break;
+        }
+        got = chunk - ku.uio_resid;
+        if (got == 0) {
+            /* end of input */
+            break;
+        }
+        *inpos = ku.uio_offset;
+
+        uio_kinit(&iov, &ku, buf, got, *outpos, UIO_WRITE);
+        result = VOP_WRITE(outfile->of_vnode, &ku);
+        put = got - ku.uio_resid;
+        *outpos = ku.uio_offset;
+        *copied += put;
+        if (put < got) {
+            /* Don't consume input we didn't manage to write */
+            *inpos -= got - put;
+            break;
+        }
+        if (result) {
+            break;
+        }
+    }
+
+    kfree(buf);
+    if (*copied > 0) {
+        result = 0;
+    }
+    return result;
+}
+
+/* 
+ * copy_file_range system call
+ *
+ * copy_file_range copies up to len bytes from the file open on infd to
+ * the file open on outfd without passing the data through userspace.
+ *
+ * For each side, if the position pointer (inpos/outpos) is NULL the copy
+ * uses and advances that file's seek position, as read and write do;
+ * otherwise it starts at *pos, updates *pos, and leaves the seek position
+ * alone (as pread and pwrite do). An explicit position on a file that
+ * cannot seek fails with ESPIPE. flags must be 0.
+ *
+ * Copying a file onto itself through the shared seek position is
+ * rejected with EINVAL.
+ * 
+ * The count of bytes copied is returned; 0 means the input was at end-of-file.
+ */
+int
+sys_copy_file_range(int infd, userptr_t inpos, int outfd, userptr_t outpos,
+                    size_t len, unsigned flags, ssize_t *bytes_copied)
+{
+    struct openfile *infile, *outfile;
+    off_t instart = 0, outstart = 0, inoff, outoff;
+    size_t copied;
+    int result;
+
+    if (flags != 0) {
+        return EINVAL;
+    }
+    /* Keep the result representable as a return value */
+    if (len > ((size_t)-1 >> 1)) {
+        len = (size_t)-1 >> 1;
+    }
+
+    result = filetable_get(curproc->p_filetable, infd, &infile);
+    if (result) {
+        return result;
+    }
+    result = filetable_get(curproc->p_filetable, outfd, &outfile);
+    if (result) {
+        filetable_put(curproc->p_filetable, infd, infile);
+        return result;
+    }
+
+    if (infile->of_accmode == O_WRONLY || outfile->of_accmode == O_RDONLY) {
+        result = EBADF;
+        goto out;
+    }
+    if (infile == outfile && inpos == NULL && outpos == NULL) {
+        /* Both sides would share (and double-lock) one seek position */
+        result = EINVAL;
+        goto out;
+    }
+
+    /*
+     * Take the offset locks in a fixed (address) order so two copies
+     * running in opposite directions between the same open files can't
+     * deadlock. At most one side's lock is taken if they're the same
+     * open file, since the check above means one side has an explicit
+     * position.
+     */
+    if (infile < outfile) {
+        copy_startio(infile, inpos, &instart);
+        copy_startio(outfile, outpos, &outstart);
+    }
+    else {
+        copy_startio(outfile, outpos, &outstart);
+        copy_startio(infile, inpos, &instart);
+    }
+    inoff = instart;
+    outoff = outstart;
+
+    result = copy_getpos(infile, inpos, &inoff);
+    if (result == 0) {
+        result = copy_getpos(outfile, outpos, &outoff);
+    }
+    if (result == 0) {
+        result = copy_data(infile, &inoff, outfile, &outoff, len, &copied);
+    }
+    if (result == 0) {
+        /*
+         * The data has moved either way; a bad position pointer at
+         * this point can only be reported, not undone.
+         */
+        result = copy_setpos(inpos, inoff);
+        if (result == 0) {
+            result = copy_setpos(outpos, outoff);
+        }
+        *bytes_copied = (ssize_t) copied;
+    }
+    else {
+        /* Nothing moved; consume nothing */
+        inoff = instart;
+        outoff = outstart;
+    }
+
+    if (infile < outfile) {
+        copy_endio(outfile, outpos, outstart, outoff);
+        copy_endio(infile, inpos, instart, inoff);
+    }
+    else {
+        copy_endio(infile, inpos, instart, inoff);
+        copy_endio(outfile, outpos, outstart, outoff);
+    }
+
+out:
+    filetable_put(curproc->p_filetable, outfd, outfile);
+    filetable_put(curproc->p_filetable, infd, infile);
+    return result;
+}
@@ -5,7 +5,8 @@
 #include <current.h>
 #include <proc.h>
 #include <vfs.h>
-#include <fd.h>
+#include <openfile.h>
+#include <filetable.h>
 
 
 
@@ -28,84 +29,35 @@
  */
 int sys_dup2(int oldfd, int newfd, int *new_fd_num)
 {
+    struct filetable *ft = curproc->p_filetable;
+    struct openfile *file, *oldfile;
+    int result;
+
     /* Check if given FDs are valid numbers */
-    if (oldfd < 0 || oldfd >= OPEN_MAX || newfd < 0 || newfd >= OPEN_MAX) {
-        /* Not valid file descriptors */
+    if (!filetable_okfd(ft, newfd)) {
         return EBADF;
     }
 
-    if (oldfd == newfd) {
-        *new_fd_num = newfd;
-        return 0;
-    }
-
-    /* Get FD structure for provided FD */
-    struct fd_table *cur_proc_fd_table = curproc->p_fd_table;
-    struct fd *old_given_fd = cur_proc_fd_table->all_fds[oldfd];
-    struct fd *new_given_fd = cur_proc_fd_table->all_fds[newfd];
-
-    
-    if (old_given_fd == NULL) {
+    result = filetable_get(ft, oldfd, &file);
+    if (result != 0) {
         /* Not a valid file descriptor */
-        return EBADF;
+        return result;
     }
 
-    /* Old FD not null at this point */
-    lock_acquire(old_given_fd->fd_lock);
-    
-    if (new_given_fd != NULL) {
-        /* 
-         * File Descriptor Exists 
-         * Copy oldfd to newfd
-         */
-        
-        /* 
-         * If Vnode reference count = 1, close the vnode
-         * Otherwise decrement the reference count 
-         */
-        struct vnode *cur_vnode = new_given_fd->fd_vnode;
-
-        spinlock_acquire(&cur_vnode->vn_countlock);
-        
-        if (cur_vnode->vn_refcount == 1) {
-            /* Must release lock before calling vfs_close */
-            spinlock_release(&cur_vnode->vn_countlock);
-            vfs_close(cur_vnode);
-        }
-        else {
-            spinlock_release(&cur_vnode->vn_countlock);
-            VOP_DECREF(cur_vnode);
-        }
-
-        /* Assign the vnode for new to the old vnode */
-        fd_destroy(newfd, cur_proc_fd_table); // Destroy the existing FD
-
-        lock_acquire(cur_proc_fd_table->fd_table_lock);
-        cur_proc_fd_table->all_fds[newfd] = old_given_fd;
-        lock_release(cur_proc_fd_table->fd_table_lock);
-
-        VOP_INCREF(old_given_fd->fd_vnode);
-
-        lock_release(old_given_fd->fd_lock);
+    if (oldfd == newfd) {
+        filetable_put(ft, oldfd, file);
         *new_fd_num = newfd;
         return 0;
     }
-    else {
-        /* 
-         * File Descriptor Does not Exist
-         * Create a new one with the file vnode in old 
-         * Copy oldfd to newfd
-         */
-        lock_acquire(cur_proc_fd_table->fd_table_lock);
-        cur_proc_fd_table->all_fds[newfd] = old_given_fd;
-        lock_release(cur_proc_fd_table->fd_table_lock);
 
-        VOP_INCREF(old_given_fd->fd_vnode);
+    /* The new slot takes over the reference filetable_get gave us */
 
-        lock_release(old_given_fd->fd_lock);
-        *new_fd_num = newfd;
-        return 0;
+    /* If newfd names an already-open file, that file is closed */
+    filetable_placeat(ft, file, newfd, &oldfile);
+    if (oldfile != NULL) {
+        openfile_decref(oldfile);
     }
 
-    /* Should not reach here */
+    *new_fd_num = newfd;
+    return 0;
 }
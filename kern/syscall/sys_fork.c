@@ -2,8 +2,9 @@
 #include <syscall.h>
 #include <current.h>
 #include <proc.h>
+#include <synch.h>
 #include <kern/errno.h>
-#include <fd.h>
+#include <filetable.h>
 #include <addrspace.h>
 #include <mips/trapframe.h>
 
@@ -28,13 +29,10 @@ int sys_fork(struct trapframe *parent_trapframe, pid_t *ret_pid)
 {
     int result;
 
-    lock_acquire(curproc->p_parent_lock);
-
     /* Get name for new child process */
     char *new_child_pname;
     new_child_pname = kstrdup(curproc->p_name);
     if (new_child_pname == NULL) {
-        lock_release(curproc->p_parent_lock);
         return ENOMEM;
     }
 
@@ -48,7 +46,6 @@ int sys_fork(struct trapframe *parent_trapframe, pid_t *ret_pid)
     if (new_child_process == NULL) {
         /* New child process cannot be created */
         kfree(new_child_pname);
-        lock_release(curproc->p_parent_lock);
         return ENPROC;
     }
 
@@ -56,15 +53,22 @@ int sys_fork(struct trapframe *parent_trapframe, pid_t *ret_pid)
 
     /* At this point, have successfully created a new child process with unique PID */
 
-    /* Copy the parent's file table structure */
-    fd_table_copy_entries(curproc->p_fd_table, new_child_process->p_fd_table);
+    /* 
+     * Share the parent's open files: the child's table points at the same
+     * openfile objects, so seek offsets are shared as in Unix.
+     */
+    result = filetable_copy(curproc->p_filetable, &new_child_process->p_filetable);
+    if (result != 0) {
+        proc_destroy(new_child_process); // Will also deallocate the PID
+        kfree(new_child_pname);
+        return result;
+    }
 
     /* Copy parent's address space to new child's address space */
     result = as_copy(curproc->p_addrspace, &(new_child_process->p_addrspace));
     if (result != 0) {
         proc_destroy(new_child_process); // Will also deallocate the PID
         kfree(new_child_pname);
-        lock_release(curproc->p_parent_lock);
         return result;
     }
 
@@ -75,35 +79,34 @@ int sys_fork(struct trapframe *parent_trapframe, pid_t *ret_pid)
         proc_destroy(new_child_process); // Will also deallocate the PID
         kfree(child_trapframe);
         kfree(new_child_pname);
-        lock_release(curproc->p_parent_lock);
         return ENOMEM;
     }
 
     memcpy((void *) child_trapframe, (const void *) parent_trapframe, sizeof(struct trapframe));
 
-    /* Add the child process to the parent's child process array */
-    unsigned index;
-    result = array_add(curproc->p_child_process_arr, (void *) new_child_process, &index);
+    /* 
+     * Add the child process to the parent's child process array 
+     * Only this part needs the family lock; the copying above doesn't.
+     */
+    lock_acquire(proc_family_lock);
+    result = proc_addchild(curproc, new_child_process);
+    lock_release(proc_family_lock);
     if (result != 0) {
         proc_destroy(new_child_process); // Will also deallocate the PID
+        kfree(child_trapframe);
         kfree(new_child_pname);
-        lock_release(curproc->p_parent_lock);
         return ENOMEM;
     }
 
-    curproc->p_num_children_running += 1;
-
-    /* Tell child what it's index is in parent's array */
-    new_child_process->p_child_index = index;
-
-    lock_release(curproc->p_parent_lock);
-
     /* 
      * Create new thread for child process 
      * Can pass the new trapframe created for the child to thread_fork
      */
     result = thread_fork(new_child_pname, new_child_process, fork_child_entrypoint, child_trapframe, 0);
     if  (result != 0) {
+        lock_acquire(proc_family_lock);
+        proc_remchild(curproc, new_child_process);
+        lock_release(proc_family_lock);
         proc_destroy(new_child_process); // Will also deallocate the PID
         kfree(child_trapframe);
         kfree(new_child_pname);
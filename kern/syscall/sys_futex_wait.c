@@ -0,0 +1,56 @@
+#include <types.h>
+#include <syscall.h>
+#include <proc.h>
+#include <copyinout.h>
+#include <futex.h>
+#include <timer.h>
+#include <kern/errno.h>
+#include <kern/time.h>
+
+/* 
+ * futex_wait system call
+ *
+ * Sleeps for as long as the 32-bit word at addr (which must be 4-byte aligned) holds
+ * expected, until another thread in the same address space calls futex_wake on addr.
+ * If timeout is not NULL, gives up after that long (rounded up to whole hardclocks);
+ * a zero timeout just checks the word.
+ *
+ * The check and going to sleep are atomic with respect to futex_wake, so a user lock
+ * can store to the word and then call futex_wake without losing a wakeup.
+ *
+ * Returns 0 once woken. Errors: EAGAIN if the word did not hold expected, ETIMEDOUT
+ * if the timeout ran out, EINVAL for a misaligned addr or a bad timeout, EFAULT for a
+ * bad pointer.
+ */
+int sys_futex_wait(userptr_t addr, uint32_t expected, const_userptr_t timeout)
+{
+    struct timespec ts;
+    unsigned ticks = 0;
+    uint32_t val;
+    int result;
+
+    if ((vaddr_t)addr % sizeof(uint32_t) != 0) {
+        return EINVAL;
+    }
+
+    if (timeout != NULL) {
+        result = copyin(timeout, &ts, sizeof(ts));
+        if (result) {
+            return result;
+        }
+        if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000) {
+            return EINVAL;
+        }
+        ticks = timer_hardclocks(&ts);
+        if (ticks == 0) {
+            // Nothing to wait for; just report whether we would have slept
+            result = copyin(addr, &val, sizeof(val));
+            if (result) {
+                return result;
+            }
+            return val == expected ? ETIMEDOUT : EAGAIN;
+        }
+    }
+
+    return futex_wait(proc_getas(), (vaddr_t)addr, expected, ticks);
+}
@@ -0,0 +1,28 @@
+#include <types.h>
+#include <syscall.h>
+#include <proc.h>
+#include <futex.h>
+#include <kern/errno.h>
+
+/* 
+ * futex_wake system call
+ *
+ * Wakes up to n threads sleeping in futex_wait on addr, in the same address space.
+ * Waking nobody is not an error.
+ *
+ * On success, the number of threads woken is returned in retval.
+ * On error (n negative) EINVAL is returned.
+ */
+int sys_futex_wake(userptr_t addr, int n, int *retval)
+{
+    unsigned woken;
+
+    if (n < 0) {
+        return EINVAL;
+    }
+
+    futex_wake(proc_getas(), (vaddr_t)addr, n, &woken);
+    *retval = woken;
+
+    return 0; // Success
+}
@@ -0,0 +1,43 @@
+#include <types.h>
+#include <syscall.h>
+#include <current.h>
+#include <proc.h>
+#include <kern/errno.h>
+#include <kern/time.h>
+#include <kern/resource.h>
+
+/* 
+ * getpriority system call
+ *
+ * Returns the priority last set with setpriority for the process named by which and who.
+ * Only PRIO_PROCESS is supported; who is a process ID, and 0 means the calling process.
+ * A process may only query itself or one of its children.
+ *
+ * A return value of 0 means the process is scheduled dynamically by the multi-level feedback queue.
+ * On error, a suitable errno is returned.
+ */
+int sys_getpriority(int which, pid_t who, int *ret_prio)
+{
+    struct proc *target;
+
+    if (which != PRIO_PROCESS) {
+        return EINVAL;
+    }
+
+    /* Find the target process */
+    if (who == 0 || who == curproc->p_process_id) {
+        target = curproc;
+    }
+    else {
+        target = proc_find_child(curproc, who);
+        if (target == NULL) {
+            return ESRCH;
+        }
+    }
+
+    spinlock_acquire(&target->p_lock);
+    *ret_prio = target->p_priority;
+    spinlock_release(&target->p_lock);
+
+    return 0; // Success
+}
@@ -0,0 +1,42 @@
+#include <types.h>
+#include <syscall.h>
+#include <current.h>
+#include <proc.h>
+#include <clock.h>
+#include <copyinout.h>
+#include <kern/errno.h>
+#include <kern/time.h>
+#include <kern/resource.h>
+
+/* 
+ * getrusage system call
+ *
+ * Reports resource usage of the calling process in the struct rusage pointed to by usage.
+ * Only RUSAGE_SELF is supported.
+ *
+ * Filled in are ru_utime (CPU time used, at hardclock resolution), ru_nvcsw (context switches
+ * made by blocking or yielding) and ru_nivcsw (context switches forced by the end of a time slice).
+ * Time spent in the kernel on the process's behalf is not told apart from user time, so it is
+ * all counted in ru_utime and ru_stime is zero. Everything else is zero.
+ *
+ * On error, a suitable errno is returned.
+ */
+int sys_getrusage(int who, userptr_t usage)
+{
+    struct rusage ru;
+    unsigned cputime, nvcsw, nivcsw;
+
+    if (who != RUSAGE_SELF) {
+        return EINVAL;
+    }
+
+    proc_getusage(curproc, &cputime, &nvcsw, &nivcsw);
+
+    bzero(&ru, sizeof(ru));
+    ru.ru_utime.tv_sec = cputime / HZ;
+    ru.ru_utime.tv_usec = (cputime % HZ) * (1000000 / HZ);
+    ru.ru_nvcsw = nvcsw;
+    ru.ru_nivcsw = nivcsw;
+
+    return copyout(&ru, usage, sizeof(ru));
+}
@@ -4,11 +4,14 @@
 #include <kern/errno.h>
 #include <current.h>
 #include <proc.h>
+#include <synch.h>
 #include <uio.h>
 #include <kern/fcntl.h>
 #include <kern/seek.h>
 #include <kern/stat.h>
-#include <fd.h>
+#include <vnode.h>
+#include <openfile.h>
+#include <filetable.h>
 
 
 /* 
@@ -26,108 +29,73 @@
  */
 int sys_lseek(int fd, off_t pos, int whence, int32_t *upper_32_ret, int32_t *lower_32_ret)
 {
-    /* Check if given FD is a valid number */
-    if (fd < 0 || fd >= OPEN_MAX) {
-        /* Not a valid file descriptor */
-        return EBADF;
-    }
-
-    /* Get FD structure for provided FD */
-    struct fd_table *cur_proc_fd_table = curproc->p_fd_table;
-    struct fd *given_fd = cur_proc_fd_table->all_fds[fd];
+    struct openfile *file;
+    struct stat cur_file_stat;
+    off_t new_pos;
+    int result;
 
-    if (given_fd == NULL) {
+    /* Get the open file for the provided FD */
+    result = filetable_get(curproc->p_filetable, fd, &file);
+    if (result != 0) {
         /* Not a valid file descriptor */
-        return EBADF;
+        return result;
     }
 
-    lock_acquire(given_fd->fd_lock);
+    /* Devices like the console have no seek position */
+    if (!file->of_seekable) {
+        filetable_put(curproc->p_filetable, fd, file);
+        return ESPIPE;
+    }
 
-    /* Define stat struct for SEEK_END case */
-    struct stat cur_file_stat;
+    /* The offset is shared with other handles on the same open file */
+    lock_acquire(file->of_offsetlock);
 
-    /* Perform lseek depending on provide whence */
+    /* Perform lseek depending on provided whence */
     switch(whence) {
         case SEEK_SET:
-            /* 
-             * New position to be set to pos 
-             * In this case, pos cannot be negative.
-             */
-            if (pos < 0) {
-                lock_release(given_fd->fd_lock);
-                return EINVAL;
-            }
-            else {
-                bool is_seekable = VOP_ISSEEKABLE(given_fd->fd_vnode);
-                if (is_seekable) {
-                    lock_release(given_fd->fd_lock);
-                    given_fd->fd_seek_pos = pos;
-                }
-                else {
-                    lock_release(given_fd->fd_lock);
-                    return ESPIPE;
-                }
-            }
-
+            /* New position to be set to pos */
+            new_pos = pos;
             break;
 
         case SEEK_CUR:
-            /* 
-             * New position is the current position plus pos 
-             * Seek positions less than zero are invalid. 
-             * Seek positions beyond EOF are legal, at least on regular files.
-             */
-            if (given_fd->fd_seek_pos + (pos) < 0) {
-                lock_release(given_fd->fd_lock);
-                return EINVAL;
-            }
-            else {
-                bool is_seekable = VOP_ISSEEKABLE(given_fd->fd_vnode);
-                if (is_seekable) {
-                    given_fd->fd_seek_pos = given_fd->fd_seek_pos + (pos);
-                }
-                else {
-                    lock_release(given_fd->fd_lock);
-                    return ESPIPE;
-                }
-            }
-
+            /* New position is the current position plus pos */
+            new_pos = file->of_offset + pos;
             break;
 
         case SEEK_END:
-            /* New position is the position of the end-of-file plus pos 
-             * Seek positions less than zero are invalid. 
-             * Seek positions beyond EOF are legal, at least on regular files.
-             */
-            VOP_STAT(given_fd->fd_vnode, &cur_file_stat);
-
-            /* Ensure that end-of-file + pos is not less than 0 */
-            if (cur_file_stat.st_size + (pos) < 0) {
-                lock_release(given_fd->fd_lock);
-                return EINVAL;
+            /* New position is the position of the end-of-file plus pos */
+            result = VOP_STAT(file->of_vnode, &cur_file_stat);
+            if (result != 0) {
+                lock_release(file->of_offsetlock);
+                filetable_put(curproc->p_filetable, fd, file);
+                return result;
             }
-            else {
-                /* Seek to a position beyond EOF is legal */
-                bool is_seekable = VOP_ISSEEKABLE(given_fd->fd_vnode);
-                if (is_seekable) {
-                    given_fd->fd_seek_pos = cur_file_stat.st_size + (pos);
-                }
-                else {
-                    lock_release(given_fd->fd_lock);
-                    return ESPIPE;
-                }
-            }
-
+            new_pos = cur_file_stat.st_size + pos;
             break;
 
         default: 
             /* Invalid whence */
+            lock_release(file->of_offsetlock);
+            filetable_put(curproc->p_filetable, fd, file);
             return EINVAL;
     }
-    
-    *upper_32_ret = (given_fd->fd_seek_pos >> 32);
-    *lower_32_ret = (given_fd->fd_seek_pos & 0xFFFFFFFF); // Gives lower 32 bits
-    lock_release(given_fd->fd_lock);
+
+    /* 
+     * Seek positions less than zero are invalid. 
+     * Seek positions beyond EOF are legal, at least on regular files.
+     */
+    if (new_pos < 0) {
+        lock_release(file->of_offsetlock);
+        filetable_put(curproc->p_filetable, fd, file);
+        return EINVAL;
+    }
+    file->of_offset = new_pos;
+
+    lock_release(file->of_offsetlock);
+    filetable_put(curproc->p_filetable, fd, file);
+
+    *upper_32_ret = (new_pos >> 32);
+    *lower_32_ret = (new_pos & 0xFFFFFFFF); // Gives lower 32 bits
 
     return 0; // Success
 }
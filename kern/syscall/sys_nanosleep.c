@@ -0,0 +1,48 @@
+#include <types.h>
+#include <copyinout.h>
+#include <syscall.h>
+#include <kern/errno.h>
+#include <kern/time.h>
+#include <clock.h>
+#include <timer.h>
+
+/* 
+ * nanosleep system call
+ *
+ * nanosleep suspends the calling thread for at least the interval in req.
+ * The interval is rounded up to a whole number of hardclocks (1/HZ seconds).
+ * An interval of zero returns straight away.
+ *
+ * There are no signals, so the sleep is never interrupted; if rem is not NULL
+ * it is set to zero.
+ *
+ * On error (bad pointer, tv_nsec outside 0..999999999, negative tv_sec) a suitable
+ * error code is returned.
+ */
+int sys_nanosleep(const_userptr_t req, userptr_t rem)
+{
+    struct timespec ts;
+    int result;
+
+    result = copyin(req, &ts, sizeof(ts));
+    if (result) {
+        return result;
+    }
+
+    if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000) {
+        return EINVAL;
+    }
+
+    clocksleep_ticks(timer_hardclocks(&ts));
+
+    if (rem != NULL) {
+        ts.tv_sec = 0;
+        ts.tv_nsec = 0;
+        result = copyout(&ts, rem, sizeof(ts));
+        if (result) {
+            return result;
+        }
+    }
+
+    return 0; // Success
+}
@@ -4,7 +4,8 @@
 #include <kern/errno.h>
 #include <proc.h>
 #include <copyinout.h>
-#include <fd.h>
+#include <openfile.h>
+#include <filetable.h>
 #include <current.h>
 
 
@@ -22,8 +23,7 @@
 int
 sys_open(const char *filename, int flags, mode_t mode, int *fd_num)
 {
-    (void) mode;
-    struct fd file_des;
+    struct openfile *file;
     int error_value;
     
     if (filename == NULL) {
@@ -32,6 +32,9 @@ sys_open(const char *filename, int flags, mode_t mode, int *fd_num)
     }
 
     char *filename_copy = (char *) kmalloc(PATH_MAX);
+    if (filename_copy == NULL) {
+        return ENOMEM;
+    }
     size_t actual_length;
     error_value = copyinstr((userptr_t) filename, filename_copy, PATH_MAX, &actual_length);
     if (error_value != 0) {
@@ -39,17 +42,19 @@ sys_open(const char *filename, int flags, mode_t mode, int *fd_num)
         return error_value;
     }
 
-    struct fd_table *cur_fd_table = curproc->p_fd_table;
-
-    /* Create a new fd and add it into fd_table */
-    error_value = fd_create(filename_copy, flags, &file_des, fd_num, cur_fd_table);
+    /* Open the file (this mangles filename_copy) */
+    error_value = openfile_open(filename_copy, flags, mode, &file);
+    kfree(filename_copy);
+    if (error_value != 0) {
+        return error_value;
+    }
 
+    /* Put it in the file table; the table takes over our reference */
+    error_value = filetable_place(curproc->p_filetable, file, fd_num);
     if (error_value != 0) {
-        kfree(filename_copy);
+        openfile_decref(file);
         return error_value;
     }
-    
-    kfree(filename_copy);
 
     return 0; // Success
 }
@@ -0,0 +1,92 @@
+#include <types.h>
+#include <copyinout.h>
+#include <syscall.h>
+#include <kern/errno.h>
+#include <kern/fcntl.h>
+#include <current.h>
+#include <proc.h>
+#include <vfs.h>
+#include <pipe.h>
+#include <openfile.h>
+#include <filetable.h>
+
+/*
+ * Drop one end of a new pipe from the file table again, if it got there.
+ */
+static
+void
+pipe_unplace(int fd)
+{
+    struct openfile *file;
+
+    filetable_placeat(curproc->p_filetable, NULL, fd, &file);
+    if (file != NULL) {
+        openfile_decref(file);
+    }
+}
+
+/* 
+ * pipe system call
+ *
+ * pipe creates an anonymous pipe and places two file handles in
+ * filehandles: filehandles[0] is open for reading the pipe and
+ * filehandles[1] for writing it. Data written to the write end can be
+ * read back from the read end in the same order.
+ *
+ * Reads wait until data is available and return end-of-file once every
+ * handle on the write end is closed. Writes wait until there is room,
+ * and fail with EPIPE once every handle on the read end is closed.
+ * Neither end can seek.
+ * 
+ * On error, no file handles are created.
+ */
+int
+sys_pipe(userptr_t filehandles)
+{
+    struct vnode *readvn, *writevn;
+    struct openfile *readfile, *writefile;
+    int fds[2];
+    int result;
+
+    result = pipe_create(&readvn, &writevn);
+    if (result) {
+        return result;
+    }
+
+    /* Each open file takes over its vnode reference */
+    readfile = openfile_create(readvn, O_RDONLY);
+    if (readfile == NULL) {
+        vfs_close(readvn);
+        vfs_close(writevn);
+        return ENOMEM;
+    }
+    writefile = openfile_create(writevn, O_WRONLY);
+    if (writefile == NULL) {
+        openfile_decref(readfile);
+        vfs_close(writevn);
+        return ENOMEM;
+    }
+
+    /* The table takes over our references */
+    result = filetable_place(curproc->p_filetable, readfile, &fds[0]);
+    if (result) {
+        openfile_decref(readfile);
+        openfile_decref(writefile);
+        return result;
+    }
+    result = filetable_place(curproc->p_filetable, writefile, &fds[1]);
+    if (result) {
+        pipe_unplace(fds[0]);
+        openfile_decref(writefile);
+        return result;
+    }
+
+    result = copyout(fds, filehandles, sizeof(fds));
+    if (result) {
+        pipe_unplace(fds[1]);
+        pipe_unplace(fds[0]);
+        return result;
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <types.h>
+#include <copyinout.h>
+#include <syscall.h>
+#include <kern/errno.h>
+#include <current.h>
+#include <proc.h>
+#include <vnode.h>
+#include <uio.h>
+#include <kern/fcntl.h>
+#include <openfile.h>
+#include <filetable.h>
+
+
+/* 
+ * pread system call
+ *
+ * pread reads up to buflen bytes from the file specified by fd, starting at
+ * the absolute position pos, and stores them in the space pointed to by buf.
+ * The file must be open for reading.
+ *
+ * Unlike read, the seek position of the file is neither used nor changed,
+ * so the offset lock is not taken and concurrent preads on a shared open
+ * file proceed in parallel.
+ * 
+ * The count of bytes read is returned; 0 signifies end-of-file. Files that
+ * cannot seek (e.g. the console) fail with ESPIPE.
+ */
+int
+sys_pread(int fd, void *buf, size_t buflen, off_t pos, ssize_t *bytes_read)
+{
+    struct openfile *file;
+    struct uio cur_file_uio;
+    struct iovec cur_file_iovec;
+    int result;
+
+    result = filetable_get(curproc->p_filetable, fd, &file);
+    if (result != 0) {
+        return result;
+    }
+
+    if (file->of_accmode == O_WRONLY) {
+        filetable_put(curproc->p_filetable, fd, file);
+        return EBADF;
+    }
+
+    if (!file->of_seekable) {
+        filetable_put(curproc->p_filetable, fd, file);
+        return ESPIPE;
+    }
+
+    if (pos < 0) {
+        filetable_put(curproc->p_filetable, fd, file);
+        return EINVAL;
+    }
+
+    cur_file_iovec.iov_ubase = (userptr_t) buf;
+    cur_file_iovec.iov_len = buflen;
+    cur_file_uio.uio_iov = &cur_file_iovec;
+    cur_file_uio.uio_iovcnt = 1;
+    cur_file_uio.uio_offset = pos;
+    cur_file_uio.uio_resid = buflen;
+    cur_file_uio.uio_segflg = UIO_USERSPACE;
+    cur_file_uio.uio_rw = UIO_READ;
+    cur_file_uio.uio_space = proc_getas();
+
+    result = VOP_READ(file->of_vnode, &cur_file_uio);
+    filetable_put(curproc->p_filetable, fd, file);
+    if (result != 0) {
+        return result;
+    }
+
+    *bytes_read = (ssize_t) (buflen - cur_file_uio.uio_resid);
+
+    return 0;
+}
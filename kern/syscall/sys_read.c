@@ -4,9 +4,12 @@
 #include <kern/errno.h>
 #include <current.h>
 #include <proc.h>
+#include <synch.h>
+#include <vnode.h>
 #include <uio.h>
 #include <kern/fcntl.h>
-#include <fd.h>
+#include <openfile.h>
+#include <filetable.h>
 
 
 /* 
@@ -25,33 +28,20 @@
 ssize_t
 sys_read(int fd, void *buf, size_t buflen, ssize_t *bytes_read)
 {
+    struct openfile *file;
+    off_t pos;
     int result = 0;
 
-    /* Check if given FD is a valid number */
-    if (fd < 0 || fd >= OPEN_MAX) {
-        /* Not a valid file descriptor */
-        return EBADF;
-    }
-
-
-    /* Get FD structure for provided FD */
-    struct fd_table *cur_proc_fd_table = curproc->p_fd_table;
-    struct fd *given_fd = cur_proc_fd_table->all_fds[fd];
-
-    if (given_fd == NULL) {
+    /* Get the open file for the provided FD; fails if fd is out of range or not open */
+    result = filetable_get(curproc->p_filetable, fd, &file);
+    if (result != 0) {
         /* Not a valid file descriptor */
-        return EBADF;
+        return result;
     }
 
-    lock_acquire(given_fd->fd_lock);
-    
-    /* Check flags of FD to ensure it can read */
-    if ((given_fd->fd_flags & O_WRONLY) == O_WRONLY) {
-        /* 
-         * Doing bitwise & with a flag checks if that particular flag is set.
-         * If Write Only, can't read this file. Can read in any other case.
-         */
-        lock_release(given_fd->fd_lock);
+    /* Check the open mode to ensure it can read */
+    if (file->of_accmode == O_WRONLY) {
+        filetable_put(curproc->p_filetable, fd, file);
         return EBADF;
     }
 
@@ -62,32 +52,40 @@ sys_read(int fd, void *buf, size_t buflen, ssize_t *bytes_read)
     struct uio cur_file_uio;
     struct iovec cur_file_iovec;
 
-    /* Initialize the uio for I/O from a kernel buffer */
-    uio_kinit(&cur_file_iovec, &cur_file_uio, (void *) buf, buflen, given_fd->fd_seek_pos, UIO_READ);
+    /* 
+     * The offset is shared with other handles on the same open file;
+     * openfile_startio locks it across the I/O where that matters.
+     */
+    pos = openfile_startio(file);
+
     cur_file_iovec.iov_ubase = (userptr_t) buf;
     cur_file_iovec.iov_len = buflen;
+    cur_file_uio.uio_iov = &cur_file_iovec;
+    cur_file_uio.uio_iovcnt = 1;
+    cur_file_uio.uio_offset = pos;
+    cur_file_uio.uio_resid = buflen;
     cur_file_uio.uio_segflg = UIO_USERSPACE;
-    cur_file_uio.uio_space = curproc->p_addrspace;
+    cur_file_uio.uio_rw = UIO_READ;
+    cur_file_uio.uio_space = proc_getas();
 
-    /* Read and update FD's seek offset */
-    result = VOP_READ(given_fd->fd_vnode, &cur_file_uio);
+    /* Read and update the seek offset */
+    result = VOP_READ(file->of_vnode, &cur_file_uio);
     if (result != 0) {
-        lock_release(given_fd->fd_lock);
+        openfile_endio(file, pos, pos);
+        filetable_put(curproc->p_filetable, fd, file);
         return result;
     }
 
-    /* Update the seek position of the FD */
-    given_fd->fd_seek_pos = cur_file_uio.uio_offset;
+    /* Update the seek position of the open file */
+    openfile_endio(file, pos, cur_file_uio.uio_offset);
+    filetable_put(curproc->p_filetable, fd, file);
 
     /* 
      * buflen is the number of bytes to read. 
      * cur_file_uio->uio_resid is the number of bytes remaining to transfer.
      * uio_resid should be 0 upon successful read of buflen bytes.
      */
-    ssize_t num_bytes_read = (ssize_t) (buflen - ((&cur_file_uio)->uio_resid));
-    *bytes_read = num_bytes_read;
-
-    lock_release(given_fd->fd_lock);
+    *bytes_read = (ssize_t) (buflen - cur_file_uio.uio_resid);
     
     return 0; // Success
 }
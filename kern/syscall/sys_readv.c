@@ -0,0 +1,95 @@
+#include <types.h>
+#include <copyinout.h>
+#include <syscall.h>
+#include <kern/errno.h>
+#include <limits.h>
+#include <lib.h>
+#include <current.h>
+#include <proc.h>
+#include <vnode.h>
+#include <uio.h>
+#include <kern/fcntl.h>
+#include <openfile.h>
+#include <filetable.h>
+
+/* iovec arrays up to this size are copied onto the stack instead of kmalloc'd */
+#define READV_FASTIOV 8
+
+
+/* 
+ * readv system call
+ *
+ * readv behaves like read, but scatters the data into the iovcnt buffers
+ * described by the iovec array iov, filling each in turn before moving
+ * to the next. The whole transfer is one operation on the file: it uses
+ * and advances the current seek position once.
+ *
+ * iovcnt must be between 1 and IOV_MAX, and the buffer lengths must not
+ * add up to more than an ssize_t can hold; otherwise readv fails with EINVAL.
+ * 
+ * The count of bytes read is returned. A return value of 0 signifies end-of-file.
+ */
+int
+sys_readv(int fd, const_userptr_t iov, int iovcnt, ssize_t *bytes_read)
+{
+    struct iovec fastiov[READV_FASTIOV];
+    struct iovec *kiov;
+    struct openfile *file;
+    struct uio cur_file_uio;
+    off_t pos, end;
+    int result;
+
+    if (iovcnt <= 0 || iovcnt > IOV_MAX) {
+        return EINVAL;
+    }
+
+    /* Copy the iovec array in; small arrays (the common case) avoid kmalloc */
+    if (iovcnt <= READV_FASTIOV) {
+        kiov = fastiov;
+    }
+    else {
+        kiov = kmalloc(iovcnt * sizeof(struct iovec));
+        if (kiov == NULL) {
+            return ENOMEM;
+        }
+    }
+    result = copyin(iov, kiov, iovcnt * sizeof(struct iovec));
+    if (result != 0) {
+        goto out;
+    }
+
+    result = filetable_get(curproc->p_filetable, fd, &file);
+    if (result != 0) {
+        goto out;
+    }
+
+    if (file->of_accmode == O_WRONLY) {
+        result = EBADF;
+        goto out_put;
+    }
+
+    /* Same offset handling as read */
+    pos = openfile_startio(file);
+    end = pos;
+
+    result = uio_uinit(kiov, iovcnt, &cur_file_uio, pos, UIO_READ);
+    if (result == 0) {
+        size_t requested = cur_file_uio.uio_resid;
+
+        result = VOP_READ(file->of_vnode, &cur_file_uio);
+        if (result == 0) {
+            end = cur_file_uio.uio_offset;
+            *bytes_read = (ssize_t) (requested - cur_file_uio.uio_resid);
+        }
+    }
+
+    openfile_endio(file, pos, end);
+
+out_put:
+    filetable_put(curproc->p_filetable, fd, file);
+out:
+    if (kiov != fastiov) {
+        kfree(kiov);
+    }
+    return result;
+}
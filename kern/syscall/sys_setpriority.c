@@ -0,0 +1,67 @@
+#include <types.h>
+#include <syscall.h>
+#include <current.h>
+#include <proc.h>
+#include <thread.h>
+#include <kern/errno.h>
+#include <kern/time.h>
+#include <kern/resource.h>
+
+/* 
+ * setpriority system call
+ *
+ * Sets the scheduling priority of the process named by which and who.
+ * Only PRIO_PROCESS is supported; who is a process ID, and 0 means the calling process.
+ * A process may only change its own priority or the priority of one of its children.
+ *
+ * prio is a Unix-style nice value between PRIO_MIN and PRIO_MAX.
+ * A value of 0 (the default) leaves the process under the control of the multi-level
+ * feedback queue. Any other value pins every thread of the process to one MLFQ level:
+ * PRIO_MIN pins it to the most urgent level and PRIO_MAX to the least urgent one.
+ * Threads the process creates later (including forked children) inherit the setting.
+ *
+ * On error, a suitable errno is returned.
+ */
+int sys_setpriority(int which, pid_t who, int prio)
+{
+    struct proc *target;
+    int level;
+
+    if (which != PRIO_PROCESS) {
+        return EINVAL;
+    }
+
+    if (prio < PRIO_MIN || prio > PRIO_MAX) {
+        return EINVAL;
+    }
+
+    /* Find the target process */
+    if (who == 0 || who == curproc->p_process_id) {
+        target = curproc;
+    }
+    else {
+        target = proc_find_child(curproc, who);
+        if (target == NULL) {
+            return ESRCH;
+        }
+    }
+
+    /* Map the nice value onto an MLFQ level */
+    if (prio == 0) {
+        level = SCHED_DYNAMIC;
+    }
+    else {
+        level = (prio - PRIO_MIN) * SCHED_NLEVELS / (PRIO_MAX - PRIO_MIN + 1);
+    }
+
+    /* Apply it to every thread in the process */
+    spinlock_acquire(&target->p_lock);
+    target->p_priority = prio;
+    unsigned num_threads = threadarray_num(&target->p_threads);
+    for (unsigned i = 0; i < num_threads; i++) {
+        thread_set_schedclass(threadarray_get(&target->p_threads, i), level);
+    }
+    spinlock_release(&target->p_lock);
+
+    return 0; // Success
+}
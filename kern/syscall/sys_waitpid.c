@@ -2,10 +2,11 @@
 #include <syscall.h>
 #include <current.h>
 #include <proc.h>
+#include <synch.h>
 #include <limits.h>
 #include <kern/errno.h>
 #include <copyinout.h>
-#include <fd.h>
+#include <kern/wait.h>
 
 /* 
  * waitpid system call
@@ -17,101 +18,94 @@
  * A process moves from "has exited already" to "does not exist" 
  * when every process that is expected to collect its exit status with waitpid has done so.
  * 
- * The options argument should be 0. You are not required to implement any options. 
- * (However, your system should check to make sure that requests for options you do not support are rejected.)
- * 
- * waitpid returns the process id whose exit status is reported in status. In OS/161, this is always the value of pid.
- * If you implement WNOHANG, and WNOHANG is given, and the process specified by pid has not yet exited, waitpid returns 0.
+ * A pid of -1 (WAIT_ANY) waits for whichever child exits first, or collects any child that
+ * already has; with no children at all it fails with ECHILD.
+ *
+ * The only option supported is WNOHANG: if no suitable child has exited yet, return 0
+ * instead of waiting. Other options are rejected with EINVAL.
+ *
+ * waitpid returns the process id whose exit status is reported in status.
  * On error, a suitable errno is returned.
+ *
+ * The child is found through the PID table (or, for any child, the zombie end of our
+ * children array) and waited for on a CV only its exit signals, so neither the lookup
+ * nor the wakeup depends on how many other children there are.
+ * Once its status is collected the child is removed from our children and handed to the
+ * workqueue to be destroyed, so we don't wait on its teardown.
  */
 int sys_waitpid(pid_t pid, int *status, int options, pid_t *ret_pid)
 {
     int result;
     int exit_status;
+    pid_t child_pid;
+    struct proc *child;
 
-    if (options != 0) {
+    if ((options & ~WNOHANG) != 0) {
         return EINVAL; // Invalid or unsupported options.
     }
 
-    lock_acquire(curproc->p_parent_lock);
-
     /* Check if PID is outside of limits */
-    if (pid < PID_MIN || pid > PID_MAX) {
-        lock_release(curproc->p_parent_lock);
+    if (pid != WAIT_ANY && (pid < PID_MIN || pid > PID_MAX)) {
         return ESRCH;
     }
 
-    /* Check if the PID is not allocated */
-    uint8_t pid_status = get_pid_status(pid);
-    if (pid_status == 0) {
-        lock_release(curproc->p_parent_lock);
-        return ESRCH;
-    }
-
-    /* Check if the PID is a child of the current process */
-
-    /* Get the number of children tracked by me */
-    unsigned num_children = array_num(curproc->p_child_process_arr);
+    lock_acquire(proc_family_lock);
 
-    int found_child = 0;
-
-    for (unsigned i = 0; i < num_children; i++) {
-        struct proc *cur_child = array_get(curproc->p_child_process_arr, i);
-        if (cur_child->p_process_id == pid) {
-            /* Found the provided child */
-            found_child = 1;
-            if (cur_child->p_is_zombie == 1) {
-                /* Child has already exited */
-                exit_status = cur_child->p_exit_status;
-                break;
-            }
-            else {
-                while(cur_child->p_is_zombie == 0) {
-                    /* 
-                     * The child has not exited
-                     * Sleep until the child exits 
-                     */
-                    cv_wait(curproc->p_parent_cv, curproc->p_parent_lock);
-
-                    /* 
-                     * After waking up, if the pid specified has exited,
-                     * we exit out of the while loop.
-                     */
-                }
+    if (pid == WAIT_ANY) {
+        if (array_num(curproc->p_child_process_arr) == 0) {
+            lock_release(proc_family_lock);
+            return ECHILD;
+        }
 
-                /* The PID specified has exited */
-                exit_status = cur_child->p_exit_status;
-                break;
+        /* Sleep until some child exits; any child's exit wakes us */
+        while ((child = proc_find_zombie(curproc)) == NULL) {
+            if (options & WNOHANG) {
+                lock_release(proc_family_lock);
+                *ret_pid = 0;
+                return 0;
             }
+            cv_wait(curproc->p_child_exit_cv, proc_family_lock);
         }
-
-        /* Otherwise, check the next child */
     }
+    else {
+        /* Check if the PID is a child of the current process */
+        child = proc_find_child(curproc, pid);
+        if (child == NULL) {
+            lock_release(proc_family_lock);
+            /* Distinguish "no such process" from "not my child" */
+            return get_pid_status(pid) == 0 ? ESRCH : ECHILD;
+        }
 
-    /* The provided PID is not a child of the current process */
-    if (found_child == 0) {
-        lock_release(curproc->p_parent_lock);
-        return ECHILD;
+        /* Sleep until the child exits; only its exit wakes us */
+        while (child->p_is_zombie == 0) {
+            if (options & WNOHANG) {
+                lock_release(proc_family_lock);
+                *ret_pid = 0;
+                return 0;
+            }
+            cv_wait(child->p_exit_cv, proc_family_lock);
+        }
     }
-
-
-    /* Copyout the exit status to userspace */
-    if (status == NULL) {
-        /* Don't update status, simply return pid */
-        *ret_pid = pid;
-        lock_release(curproc->p_parent_lock);
-        return 0;
+    exit_status = child->p_exit_status;
+    child_pid = child->p_process_id;
+
+    lock_release(proc_family_lock);
+
+    /* 
+     * Copyout the exit status to userspace before reaping, so that a 
+     * bad pointer leaves the child there to be waited for again.
+     * We're the only thread in this process, so nobody else can reap it meanwhile.
+     */
+    if (status != NULL) {
+        result = copyout(&exit_status, (userptr_t) status, sizeof(int));
+        if (result != 0) {
+            return result;
+        }
     }
 
-    /* status pointer is provided, so do copyout */
-    result = copyout(&exit_status, (userptr_t) status, sizeof(int));
-    if (result != 0) {
-        lock_release(curproc->p_parent_lock);
-        return result;
-    }
+    /* Reap: the child has detached its thread, so it can go now */
+    proc_reap(curproc, child);
 
-    /* copyout complete, success */
-    *ret_pid = pid;
-    lock_release(curproc->p_parent_lock);
+    *ret_pid = child_pid;
     return 0;
-}
\ No newline at end of file
+}
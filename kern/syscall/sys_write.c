@@ -5,9 +5,11 @@
 #include <kern/errno.h>
 #include <current.h>
 #include <proc.h>
+#include <synch.h>
 #include <uio.h>
 #include <vnode.h>
-#include <fd.h>
+#include <openfile.h>
+#include <filetable.h>
 
 
 /* 
@@ -25,60 +27,59 @@
  */
 int sys_write(int fd, const void *buf, size_t nbytes, ssize_t *bytes_written)
 {
+    struct openfile *file;
+    off_t pos;
     struct iovec cur_file_iovec;
     struct uio cur_file_uio;
+    int result;
 
-    if (fd < 0 || fd >= OPEN_MAX) {
-        /* Not a valid file descriptor */
-        return EBADF;
+    /* Get the open file for the provided FD; fails if fd is out of range or not open */
+    result = filetable_get(curproc->p_filetable, fd, &file);
+    if (result != 0) {
+        /* Not a valid file descriptor, file is not open */
+        return result;
     }
 
-    /* Get FD structure for provided FD */
-    struct fd_table *cur_proc_fd_table = curproc->p_fd_table;
-    struct fd *given_fd = cur_proc_fd_table->all_fds[fd];
-
-    if (given_fd == NULL) {
-         /* Not a valid file descriptor, file is not open */
+    /* Check the open mode to ensure it can write */
+    if (file->of_accmode == O_RDONLY) {
+        filetable_put(curproc->p_filetable, fd, file);
         return EBADF;
     }
 
-    lock_acquire(given_fd->fd_lock);
-
-     /* Check flags of FD to ensure it is strictly write only */
-    if (!(given_fd->fd_flags & (O_RDWR | O_WRONLY))) {
-        /* 
-         * Doing bitwise & with a flag checks if that particular flag is set.
-         * Check if the flags has either RDWR or WRONLY. (RDWR | WRONLY = 11)
-         */
-        lock_release(given_fd->fd_lock);
-        return EBADF;
-    }
+    /* 
+     * The offset is shared with other handles on the same open file;
+     * openfile_startio locks it across the I/O where that matters.
+     */
+    pos = openfile_startio(file);
 
     /* initialize cur_file_iovec and cur_file_uio */
-    uio_kinit(&cur_file_iovec, &cur_file_uio, (void*) buf, nbytes, given_fd->fd_seek_pos, UIO_WRITE);
     cur_file_iovec.iov_ubase = (userptr_t) buf;
     cur_file_iovec.iov_len = nbytes;
+    cur_file_uio.uio_iov = &cur_file_iovec;
+    cur_file_uio.uio_iovcnt = 1;
+    cur_file_uio.uio_offset = pos;
+    cur_file_uio.uio_resid = nbytes;
     cur_file_uio.uio_segflg = UIO_USERSPACE;
-    cur_file_uio.uio_space = curproc->p_addrspace;
-
-    /* Write to the vnode given by the FD */
-    int result = VOP_WRITE(given_fd->fd_vnode, &cur_file_uio);
+    cur_file_uio.uio_rw = UIO_WRITE;
+    cur_file_uio.uio_space = proc_getas();
 
+    /* Write to the vnode of the open file */
+    result = VOP_WRITE(file->of_vnode, &cur_file_uio);
     if (result != 0) {
-        lock_release(given_fd->fd_lock);
+        openfile_endio(file, pos, pos);
+        filetable_put(curproc->p_filetable, fd, file);
         return result;
     }
 
-     /* Update the seek position of the FD */
-    given_fd->fd_seek_pos = cur_file_uio.uio_offset;
+    /* Update the seek position of the open file */
+    openfile_endio(file, pos, cur_file_uio.uio_offset);
+    filetable_put(curproc->p_filetable, fd, file);
 
      /* 
       * cur_file_uio->uio_resid is the number of bytes remaining to transfer.
-      * uio_resid should be 0 upon successful read of buflen bytes.
+      * uio_resid should be 0 upon successful write of nbytes bytes.
       */
-    *bytes_written = (ssize_t) (nbytes - ((&cur_file_uio)->uio_resid));
-
-    lock_release(given_fd->fd_lock);
+    *bytes_written = (ssize_t) (nbytes - cur_file_uio.uio_resid);
     
     return 0; // Success
 }
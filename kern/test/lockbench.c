@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Lock wait-time benchmark.
+ *
+ * A crowd of threads takes turns at one lock (and then at one
+ * semaphore used as a mutex), timing how long each acquisition
+ * waited. This is run once in the default mode, where a newly
+ * arriving or spinning thread can grab the lock ahead of threads that
+ * are already asleep on it, and once in handoff mode, where the lock
+ * goes to the longest waiter. The interesting number is the tail:
+ * handoff should cut p99 and max wait, at some cost in total time.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <clock.h>
+#include <thread.h>
+#include <synch.h>
+#include <test.h>
+
+#define LB_THREADS        12
+#define LB_DEFAULT_LOOPS  200
+#define LB_HOLD           2000	/* busy loop iterations inside the lock */
+#define LB_THINK          500	/* and outside */
+
+static struct lock *lb_lock;
+static struct semaphore *lb_sem;
+static struct semaphore *lb_done;
+static uint32_t *lb_waits;	/* nanoseconds waited, per acquisition */
+static unsigned lb_loops;
+
+static
+void
+lb_busy(unsigned n)
+{
+	volatile unsigned i;
+
+	for (i=0; i<n; i++) {
+		/* nothing */
+	}
+}
+
+static
+void
+lb_thread(void *junk, unsigned long num)
+{
+	struct timespec before, after, diff;
+	uint64_t nsecs;
+	unsigned i;
+
+	(void)junk;
+
+	for (i=0; i<lb_loops; i++) {
+		gettime(&before);
+		if (lb_sem != NULL) {
+			P(lb_sem);
+		}
+		else {
+			lock_acquire(lb_lock);
+		}
+		gettime(&after);
+
+		lb_busy(LB_HOLD);
+
+		if (lb_sem != NULL) {
+			V(lb_sem);
+		}
+		else {
+			lock_release(lb_lock);
+		}
+
+		timespec_sub(&after, &before, &diff);
+		nsecs = (uint64_t)diff.tv_sec * 1000000000 + diff.tv_nsec;
+		lb_waits[num * lb_loops + i] =
+			nsecs > 0xffffffff ? 0xffffffff : nsecs;
+
+		lb_busy(LB_THINK);
+	}
+	V(lb_done);
+}
+
+static
+void
+lb_run(bool usesem, bool handoff)
+{
+	struct timespec before, after, diff;
+	unsigned i, n;
+	int result;
+
+	if (usesem) {
+		lb_sem = sem_create("lockbench", 1);
+		if (lb_sem == NULL) {
+			panic("lockbench: sem_create failed\n");
+		}
+		sem_sethandoff(lb_sem, handoff);
+	}
+	else {
+		lb_lock = lock_create("lockbench");
+		if (lb_lock == NULL) {
+			panic("lockbench: lock_create failed\n");
+		}
+		lock_sethandoff(lb_lock, handoff);
+	}
+
+	gettime(&before);
+	for (i=0; i<LB_THREADS; i++) {
+		result = thread_fork("lockbench", NULL, lb_thread, NULL, i);
+		if (result) {
+			panic("lockbench: thread_fork failed: %s\n",
+			      strerror(result));
+		}
+	}
+	for (i=0; i<LB_THREADS; i++) {
+		P(lb_done);
+	}
+	gettime(&after);
+	timespec_sub(&after, &before, &diff);
+
+	n = LB_THREADS * lb_loops;
+	sort_uint32(lb_waits, n);
+	kprintf("%-4s %-7s %8u %10lu %10lu %10lu %4llu.%03lu\n",
+		usesem ? "sem" : "lock", handoff ? "handoff" : "barging",
+		n, (unsigned long)lb_waits[n/2],
+		(unsigned long)lb_waits[(n*99)/100],
+		(unsigned long)lb_waits[n-1],
+		(unsigned long long)diff.tv_sec,
+		(unsigned long)(diff.tv_nsec / 1000000));
+
+	if (usesem) {
+		sem_destroy(lb_sem);
+		lb_sem = NULL;
+	}
+	else {
+		lock_destroy(lb_lock);
+		lb_lock = NULL;
+	}
+}
+
+int
+lockbench(int nargs, char **args)
+{
+	if (nargs > 2) {
+		kprintf("Usage: lb1 [loops]\n");
+		return EINVAL;
+	}
+	lb_loops = nargs == 2 ? (unsigned)atoi(args[1]) : LB_DEFAULT_LOOPS;
+	if (lb_loops == 0) {
+		kprintf("lockbench: loops must be positive\n");
+		return EINVAL;
+	}
+
+	lb_done = sem_create("lockbench done", 0);
+	if (lb_done == NULL) {
+		panic("lockbench: sem_create failed\n");
+	}
+	lb_waits = kmalloc(LB_THREADS * lb_loops * sizeof(lb_waits[0]));
+	if (lb_waits == NULL) {
+		sem_destroy(lb_done);
+		return ENOMEM;
+	}
+
+	kprintf("Starting lock wait-time benchmark: %u threads x %u loops\n",
+		LB_THREADS, lb_loops);
+	kprintf("%-4s %-7s %8s %10s %10s %10s %8s\n", "kind", "mode",
+		"samples", "p50 ns", "p99 ns", "max ns", "total s");
+	lb_run(false, false);
+	lb_run(false, true);
+	lb_run(true, false);
+	lb_run(true, true);
+
+	kfree(lb_waits);
+	sem_destroy(lb_done);
+	kprintf("Lock wait-time benchmark done.\n");
+	return 0;
+}
@@ -32,8 +32,10 @@
  */
 
 #include <types.h>
+#include <kern/errno.h>
 #include <lib.h>
 #include <clock.h>
+#include <spinlock.h>
 #include <thread.h>
 #include <synch.h>
 #include <test.h>
@@ -196,6 +198,7 @@ int
 locktest(int nargs, char **args)
 {
 	int i, result;
+	struct lock_stats stats;
 
 	(void)nargs;
 	(void)args;
@@ -215,6 +218,12 @@ locktest(int nargs, char **args)
 		P(donesem);
 	}
 
+	lock_getstats(testlock, &stats);
+	kprintf("testlock: %u acquires, %u contended, %u won by spinning, "
+		"%u sleeps, %llu spins\n", stats.ls_acquires,
+		stats.ls_contended, stats.ls_spinwins, stats.ls_sleeps,
+		(unsigned long long)stats.ls_spins);
+
 	kprintf("Lock test done.\n");
 
 	return 0;
@@ -399,3 +408,390 @@ cvtest2(int nargs, char **args)
 	kprintf("cvtest2 done\n");
 	return 0;
 }
+
+////////////////////////////////////////////////////////////
+//
+// rwlock test
+//
+// Readers check that the three test values are consistent with each
+// other and track how many of them are inside at once; writers change
+// all three values. A reader that sees a half-done write, or a writer
+// that finds anyone else inside, fails the test.
+
+#define NRWLOOPS      100
+#define NRWWRITERS    4
+
+static struct rwlock *testrwlock;
+static volatile unsigned rwtest_readers;
+static volatile unsigned rwtest_maxreaders;
+static volatile unsigned rwtest_writers;
+static volatile bool rwtest_failed;
+static struct spinlock rwtest_spinlock = SPINLOCK_INITIALIZER;
+
+static
+void
+rwfail(unsigned long num, const char *msg)
+{
+	kprintf("thread %lu: %s\n", num, msg);
+	rwtest_failed = true;
+}
+
+static
+void
+rwtestreader(void *junk, unsigned long num)
+{
+	int i;
+	unsigned long v1, v2, v3;
+	(void)junk;
+
+	for (i=0; i<NRWLOOPS; i++) {
+		rwlock_acquire_read(testrwlock);
+
+		spinlock_acquire(&rwtest_spinlock);
+		rwtest_readers++;
+		if (rwtest_readers > rwtest_maxreaders) {
+			rwtest_maxreaders = rwtest_readers;
+		}
+		if (rwtest_writers != 0) {
+			rwfail(num, "reader inside with a writer");
+		}
+		spinlock_release(&rwtest_spinlock);
+
+		v1 = testval1;
+		thread_yield();
+		v2 = testval2;
+		v3 = testval3;
+		if (v2 != v1*v1 || v3 != v1%3) {
+			rwfail(num, "reader saw a torn write");
+		}
+
+		spinlock_acquire(&rwtest_spinlock);
+		rwtest_readers--;
+		spinlock_release(&rwtest_spinlock);
+
+		rwlock_release_read(testrwlock);
+	}
+	V(donesem);
+}
+
+static
+void
+rwtestwriter(void *junk, unsigned long num)
+{
+	int i;
+	(void)junk;
+
+	for (i=0; i<NRWLOOPS; i++) {
+		rwlock_acquire_write(testrwlock);
+
+		spinlock_acquire(&rwtest_spinlock);
+		rwtest_writers++;
+		if (rwtest_writers != 1 || rwtest_readers != 0) {
+			rwfail(num, "writer not alone");
+		}
+		spinlock_release(&rwtest_spinlock);
+
+		testval1 = num + i;
+		thread_yield();
+		testval2 = testval1*testval1;
+		testval3 = testval1%3;
+
+		spinlock_acquire(&rwtest_spinlock);
+		rwtest_writers--;
+		spinlock_release(&rwtest_spinlock);
+
+		rwlock_release_write(testrwlock);
+		thread_yield();
+	}
+	V(donesem);
+}
+
+int
+rwtest(int nargs, char **args)
+{
+	int i, result;
+
+	(void)nargs;
+	(void)args;
+
+	inititems();
+	if (testrwlock == NULL) {
+		testrwlock = rwlock_create("testrwlock");
+		if (testrwlock == NULL) {
+			panic("rwtest: rwlock_create failed\n");
+		}
+	}
+	kprintf("Starting rwlock test...\n");
+
+	testval1 = 0;
+	testval2 = 0;
+	testval3 = 0;
+	rwtest_readers = 0;
+	rwtest_maxreaders = 0;
+	rwtest_writers = 0;
+	rwtest_failed = false;
+
+	/*
+	 * Interleave the writers among the readers so that the writers
+	 * have to get in while readers keep arriving. If readers could
+	 * starve writers (or the other way around) this hangs.
+	 */
+	for (i=0; i<NTHREADS; i++) {
+		if (i % (NTHREADS / NRWWRITERS) == 0) {
+			result = thread_fork("rwtest", NULL, rwtestwriter,
+					     NULL, i);
+		}
+		else {
+			result = thread_fork("rwtest", NULL, rwtestreader,
+					     NULL, i);
+		}
+		if (result) {
+			panic("rwtest: thread_fork failed: %s\n",
+			      strerror(result));
+		}
+	}
+	for (i=0; i<NTHREADS; i++) {
+		P(donesem);
+	}
+
+	kprintf("At most %u readers held the lock at once\n",
+		rwtest_maxreaders);
+	if (rwtest_failed) {
+		kprintf("Test failed\n");
+	}
+	kprintf("RW lock test done.\n");
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// timed wait test
+//
+// Each thread does a few cv_timedwaits that nobody signals, with
+// different timeouts, and checks that each one times out and took at
+// least as long as asked. Then the main thread waits with a long
+// timeout while a helper signals it, which must not time out.
+
+#define NTIMEDLOOPS   4
+
+static volatile bool timedtest_failed;
+static volatile bool timedtest_signalled;
+
+static
+void
+timedtestthread(void *junk, unsigned long num)
+{
+	struct timespec before, after, diff;
+	unsigned ticks;
+	int i, result;
+	(void)junk;
+
+	for (i=0; i<NTIMEDLOOPS; i++) {
+		ticks = 1 + (num + i) % 5;
+
+		lock_acquire(testlock);
+		gettime(&before);
+		result = cv_timedwait(testcv, testlock, ticks);
+		gettime(&after);
+		lock_release(testlock);
+
+		timespec_sub(&after, &before, &diff);
+		if (result != ETIMEDOUT) {
+			kprintf("thread %lu: woken without a signal\n", num);
+			timedtest_failed = true;
+		}
+		else if ((uint64_t)diff.tv_sec * 1000000000 + diff.tv_nsec <
+			 (uint64_t)(ticks - 1) * (1000000000 / HZ)) {
+			kprintf("thread %lu: woke after %lu ns for %u ticks\n",
+				num, (unsigned long)diff.tv_nsec, ticks);
+			timedtest_failed = true;
+		}
+	}
+	V(donesem);
+}
+
+static
+void
+timedtestsignaller(void *junk, unsigned long num)
+{
+	(void)junk;
+	(void)num;
+
+	lock_acquire(testlock);
+	timedtest_signalled = true;
+	cv_signal(testcv, testlock);
+	lock_release(testlock);
+	V(donesem);
+}
+
+int
+timedwaittest(int nargs, char **args)
+{
+	int i, result;
+
+	(void)nargs;
+	(void)args;
+
+	inititems();
+	kprintf("Starting timed wait test...\n");
+	timedtest_failed = false;
+	timedtest_signalled = false;
+
+	for (i=0; i<NTHREADS; i++) {
+		result = thread_fork("timedtest", NULL, timedtestthread,
+				     NULL, i);
+		if (result) {
+			panic("timedwaittest: thread_fork failed: %s\n",
+			      strerror(result));
+		}
+	}
+	for (i=0; i<NTHREADS; i++) {
+		P(donesem);
+	}
+
+	lock_acquire(testlock);
+	result = thread_fork("timedtest", NULL, timedtestsignaller, NULL, 0);
+	if (result) {
+		panic("timedwaittest: thread_fork failed: %s\n",
+		      strerror(result));
+	}
+	while (!timedtest_signalled) {
+		result = cv_timedwait(testcv, testlock, 10 * HZ);
+		if (result == ETIMEDOUT) {
+			kprintf("Timed out even though signalled\n");
+			timedtest_failed = true;
+			break;
+		}
+	}
+	lock_release(testlock);
+	P(donesem);
+
+	if (timedtest_failed) {
+		kprintf("Test failed\n");
+	}
+	kprintf("Timed wait test done.\n");
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// spinlock contention benchmark
+//
+// A handful of threads (more than sys161 usually has CPUs, so every
+// CPU gets one) hammer a single spinlock, once for each flavor.
+// Inside the lock each thread does a non-atomic update of a shared
+// counter, so a lost update means mutual exclusion broke. Besides the
+// total time, we report when the first and last threads finished: with
+// an unfair lock some CPUs get through their loops early while others
+// starve, and the gap shows it.
+
+#define NSPINTHREADS  8
+#define NSPINLOOPS    2000
+#define SPINHOLD      50
+
+static struct spinlock spintest_lock;
+static volatile unsigned long spintest_count;
+static struct timespec spintest_start;
+static uint64_t spintest_finish[NSPINTHREADS];
+
+static
+void
+spintestthread(void *junk, unsigned long num)
+{
+	struct timespec now, diff;
+	volatile unsigned j;
+	unsigned long val;
+	unsigned i;
+
+	(void)junk;
+
+	for (i=0; i<NSPINLOOPS; i++) {
+		spinlock_acquire(&spintest_lock);
+		val = spintest_count;
+		for (j=0; j<SPINHOLD; j++) {
+			/* nothing */
+		}
+		spintest_count = val + 1;
+		spinlock_release(&spintest_lock);
+	}
+
+	gettime(&now);
+	timespec_sub(&now, &spintest_start, &diff);
+	spintest_finish[num] =
+		(uint64_t)diff.tv_sec * 1000000000 + diff.tv_nsec;
+	V(donesem);
+}
+
+static
+bool
+spintestrun(spinlock_kind_t kind, const char *name)
+{
+	uint64_t first, last;
+	unsigned i;
+	int result;
+
+	spinlock_init(&spintest_lock);
+	spinlock_setkind(&spintest_lock, kind);
+	spintest_count = 0;
+
+	gettime(&spintest_start);
+	for (i=0; i<NSPINTHREADS; i++) {
+		result = thread_fork("spintest", NULL, spintestthread,
+				     NULL, i);
+		if (result) {
+			panic("spintest: thread_fork failed: %s\n",
+			      strerror(result));
+		}
+	}
+	for (i=0; i<NSPINTHREADS; i++) {
+		P(donesem);
+	}
+	spinlock_cleanup(&spintest_lock);
+
+	first = last = spintest_finish[0];
+	for (i=1; i<NSPINTHREADS; i++) {
+		if (spintest_finish[i] < first) {
+			first = spintest_finish[i];
+		}
+		if (spintest_finish[i] > last) {
+			last = spintest_finish[i];
+		}
+	}
+	kprintf("%-8s %10llu %10llu %10llu\n", name,
+		(unsigned long long)(last / 1000),
+		(unsigned long long)(first / 1000),
+		(unsigned long long)((last - first) / 1000));
+
+	if (spintest_count != (unsigned long)NSPINTHREADS * NSPINLOOPS) {
+		kprintf("%s: count %lu, expected %lu\n", name, spintest_count,
+			(unsigned long)NSPINTHREADS * NSPINLOOPS);
+		return false;
+	}
+	return true;
+}
+
+int
+spintest(int nargs, char **args)
+{
+	bool ok = true;
+
+	(void)nargs;
+	(void)args;
+
+	inititems();
+	kprintf("Starting spinlock benchmark: %u threads x %u loops\n",
+		NSPINTHREADS, NSPINLOOPS);
+	kprintf("%-8s %10s %10s %10s\n", "kind", "total us", "first us",
+		"spread us");
+	ok = spintestrun(SPINLOCK_TTAS, "ttas") && ok;
+	ok = spintestrun(SPINLOCK_BACKOFF, "backoff") && ok;
+	ok = spintestrun(SPINLOCK_TICKET, "ticket") && ok;
+
+	if (!ok) {
+		kprintf("Test failed\n");
+	}
+	kprintf("Spinlock benchmark done.\n");
+	return 0;
+}
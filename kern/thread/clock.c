@@ -34,13 +34,14 @@
 #include <clock.h>
 #include <thread.h>
 #include <current.h>
+#include <timer.h>
+#include <mainbus.h>
 
 /*
  * Time handling.
  *
- * This is pretty primitive. A real kernel will typically have some
- * kind of support for scheduling callbacks to happen at specific
- * points in the future, usually with more resolution that one second.
+ * Callbacks at specific points in the future are handled by the
+ * per-cpu timer wheels in timer.c, which hardclock() advances.
  *
  * A real kernel also has to maintain the time of day; in OS/161 we
  * skimp on that because we have a known-good hardware clock.
@@ -51,13 +52,13 @@
  * the scheduler.
  */
 #define SCHEDULE_HARDCLOCKS	4	/* Reschedule every 4 hardclocks. */
-#define MIGRATE_HARDCLOCKS	16	/* Migrate every 16 hardclocks. */
 
 /*
- * Once a second, everything waiting on lbolt is awakened by CPU 0.
+ * Threads in clocksleep wait here. Nobody ever wakes this channel;
+ * each sleeper's own timer takes it off when its time is up.
  */
-static struct wchan *lbolt;
-static struct spinlock lbolt_lock;
+static struct wchan *sleep_wchan;
+static struct spinlock sleep_lock;
 
 /*
  * Setup.
@@ -65,10 +66,10 @@ static struct spinlock lbolt_lock;
 void
 hardclock_bootstrap(void)
 {
-	spinlock_init(&lbolt_lock);
-	lbolt = wchan_create("lbolt");
-	if (lbolt == NULL) {
-		panic("Couldn't create lbolt\n");
+	spinlock_init(&sleep_lock);
+	sleep_wchan = wchan_create("clocksleep");
+	if (sleep_wchan == NULL) {
+		panic("Couldn't create clocksleep wchan\n");
 	}
 }
 
@@ -79,10 +80,10 @@ hardclock_bootstrap(void)
 void
 timerclock(void)
 {
-	/* Just broadcast on lbolt */
-	spinlock_acquire(&lbolt_lock);
-	wchan_wakeall(lbolt, &lbolt_lock);
-	spinlock_release(&lbolt_lock);
+	/*
+	 * Nothing to do. This used to wake every clocksleep sleeper
+	 * once a second; timed sleeps now use the timer wheels.
+	 */
 }
 
 /*
@@ -97,13 +98,57 @@ hardclock(void)
 	 */
 
 	curcpu->c_hardclocks++;
-	if ((curcpu->c_hardclocks % MIGRATE_HARDCLOCKS) == 0) {
-		thread_consider_migration();
-	}
+	timerwheel_tick();
+	/* Load balancing is done by idle CPUs stealing; see thread.c. */
 	if ((curcpu->c_hardclocks % SCHEDULE_HARDCLOCKS) == 0) {
 		schedule();
 	}
-	thread_yield();
+	thread_timeslice();
+}
+
+/*
+ * Stop hardclock on an idle cpu, leaving a wakeup for its next timer.
+ */
+void
+hardclock_idle(void)
+{
+	KASSERT(curthread->t_curspl > 0);
+
+	curcpu->c_tickless = true;
+	curcpu->c_tickless_ticks = mainbus_timer_oneshot(timerwheel_idle_ticks());
+}
+
+/*
+ * Restart hardclock on a cpu that was idle, and account for the time
+ * it slept through. Nothing else hardclock does matters while there
+ * was nothing to run, so just the tick count and the timers need
+ * catching up.
+ */
+void
+hardclock_resume(bool timer_expired)
+{
+	unsigned ticks;
+
+	KASSERT(curthread->t_curspl > 0);
+
+	if (!curcpu->c_tickless) {
+		/* Already done, by the timer interrupt that woke us */
+		return;
+	}
+	curcpu->c_tickless = false;
+
+	/*
+	 * The cycle counter restarts when the one-shot timer fires, so
+	 * it only tells us the elapsed time for an early wakeup (an IPI
+	 * or device interrupt). If the timer itself woke us, the full
+	 * interval it was set for has gone by.
+	 */
+	ticks = mainbus_timer_periodic();
+	if (timer_expired) {
+		ticks = curcpu->c_tickless_ticks;
+	}
+	curcpu->c_hardclocks += ticks;
+	timerwheel_advance(ticks);
 }
 
 /*
@@ -112,10 +157,22 @@ hardclock(void)
 void
 clocksleep(int num_secs)
 {
-	spinlock_acquire(&lbolt_lock);
-	while (num_secs > 0) {
-		wchan_sleep(lbolt, &lbolt_lock);
-		num_secs--;
+	if (num_secs > 0) {
+		clocksleep_ticks((unsigned)num_secs * HZ);
 	}
-	spinlock_release(&lbolt_lock);
+}
+
+/*
+ * Suspend execution for n hardclocks.
+ */
+void
+clocksleep_ticks(unsigned ticks)
+{
+	if (ticks == 0) {
+		return;
+	}
+
+	spinlock_acquire(&sleep_lock);
+	wchan_sleep_timeout(sleep_wchan, &sleep_lock, ticks);
+	spinlock_release(&sleep_lock);
 }
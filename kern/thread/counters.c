@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Per-cpu event counters. See counters.h.
+ */
+
+#include <types.h>
+#include <endian.h>
+#include <lib.h>
+#include <spl.h>
+#include <cpu.h>
+#include <current.h>
+#include <counters.h>
+
+static const char *const counter_names[CTR_NFIXED] = {
+	[CTR_SYSCALL] = "syscalls",
+	[CTR_VMFAULT] = "vm_faults",
+	[CTR_INTERRUPT] = "interrupts",
+	[CTR_CTXSWITCH] = "context_switches",
+	[CTR_PREEMPT] = "preemptions",
+	[CTR_KMALLOC] = "kmallocs",
+	[CTR_KFREE] = "kfrees",
+	[CTR_DISK_READ] = "disk_sectors_read",
+	[CTR_DISK_WRITE] = "disk_sectors_written",
+};
+
+void
+counter_add(unsigned ctr, uint64_t n)
+{
+	int s;
+
+	KASSERT(ctr < NCOUNTERS);
+
+	/* Too early to count anything (kmalloc in early boot). */
+	if (!CURCPU_EXISTS()) {
+		return;
+	}
+
+	/* Interrupts off so we can't be preempted onto another cpu. */
+	s = splhigh();
+	curcpu->c_counters[ctr] += n;
+	splx(s);
+}
+
+void
+counter_syscall(unsigned callno)
+{
+	int s;
+
+	if (!CURCPU_EXISTS()) {
+		return;
+	}
+
+	s = splhigh();
+	curcpu->c_counters[CTR_SYSCALL]++;
+	if (callno < CTR_NSYSCALLS) {
+		curcpu->c_counters[CTR_SYSCALL_BASE + callno]++;
+	}
+	splx(s);
+}
+
+uint64_t
+counter_get(struct cpu *c, unsigned ctr)
+{
+	volatile uint32_t *halves;
+	uint32_t hi, lo;
+	unsigned hiword;
+
+	KASSERT(ctr < NCOUNTERS);
+
+	/*
+	 * A 64-bit load isn't atomic on a 32-bit machine, so this can
+	 * read a torn value while the owner carries into the high
+	 * word. Since the owner only ever increments, just read until
+	 * the high word holds still.
+	 */
+	halves = (volatile uint32_t *)&c->c_counters[ctr];
+	hiword = (_BYTE_ORDER == _BIG_ENDIAN) ? 0 : 1;
+	do {
+		hi = halves[hiword];
+		lo = halves[1 - hiword];
+	} while (hi != halves[hiword]);
+
+	return ((uint64_t)hi << 32) | lo;
+}
+
+uint64_t
+counter_read(unsigned ctr)
+{
+	uint64_t total = 0;
+	unsigned i;
+
+	for (i=0; i<cpu_count(); i++) {
+		total += counter_get(cpu_get(i), ctr);
+	}
+	return total;
+}
+
+const char *
+counter_name(unsigned ctr)
+{
+	KASSERT(ctr < CTR_NFIXED);
+	return counter_names[ctr];
+}
+
+/*
+ * Every line is exactly COUNTERS_LINELEN bytes, so a reader going
+ * through the text in pieces finds the lines where it left them even
+ * though the numbers change between reads.
+ */
+static
+size_t
+counters_line(char *buf, size_t len, const char *name, unsigned num,
+	      uint64_t val)
+{
+	char tmp[COUNTERS_LINELEN + 1];
+
+	if (len < COUNTERS_LINELEN) {
+		return 0;
+	}
+	if (name != NULL) {
+		snprintf(tmp, sizeof(tmp), "%-20s %18llu\n", name,
+			 (unsigned long long)val);
+	}
+	else {
+		snprintf(tmp, sizeof(tmp), "syscall.%-12u %18llu\n", num,
+			 (unsigned long long)val);
+	}
+	KASSERT(strlen(tmp) == COUNTERS_LINELEN);
+	memcpy(buf, tmp, COUNTERS_LINELEN);
+	return COUNTERS_LINELEN;
+}
+
+size_t
+counters_format(char *buf, size_t len)
+{
+	size_t pos = 0;
+	uint64_t val;
+	unsigned i;
+
+	for (i=0; i<CTR_NFIXED; i++) {
+		pos += counters_line(buf + pos, len - pos, counter_names[i],
+				     0, counter_read(i));
+	}
+	/*
+	 * Only the system calls somebody has used. Counts only grow,
+	 * so lines may appear between reads but never go away.
+	 */
+	for (i=0; i<CTR_NSYSCALLS; i++) {
+		val = counter_read(CTR_SYSCALL_BASE + i);
+		if (val > 0) {
+			pos += counters_line(buf + pos, len - pos, NULL, i,
+					     val);
+		}
+	}
+	return pos;
+}
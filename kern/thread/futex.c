@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Futexes. See futex.h.
+ *
+ * Each hash bucket has a sleep lock, a spinlock and a wait channel.
+ * The sleep lock covers checking the user word and queueing up (the
+ * check is a copyin, which can fault and so can't be done under a
+ * spinlock); the spinlock covers the waiter list and goes with the
+ * wait channel. A waiter takes the spinlock before dropping the sleep
+ * lock, and a waker needs both, so a wakeup can't slip in between the
+ * check and the sleep.
+ *
+ * Waiters for different words can share a bucket, and so a channel;
+ * each one records its key and thread in a list, and futex_wake picks
+ * out the matching ones with wchan_wakethread.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <spinlock.h>
+#include <wchan.h>
+#include <synch.h>
+#include <thread.h>
+#include <current.h>
+#include <copyinout.h>
+#include <futex.h>
+
+#define FUTEX_NBUCKETS  64
+
+struct futex_waiter {
+	struct futex_waiter *fw_next;
+	struct addrspace *fw_as;
+	vaddr_t fw_uaddr;
+	struct thread *fw_thread;
+};
+
+struct futex_bucket {
+	struct lock *fb_lock;
+	struct spinlock fb_spinlock;
+	struct wchan *fb_wchan;
+	struct futex_waiter *fb_waiters;
+};
+
+static struct futex_bucket futex_buckets[FUTEX_NBUCKETS];
+
+static
+struct futex_bucket *
+futex_hash(struct addrspace *as, vaddr_t uaddr)
+{
+	uint32_t h;
+
+	h = (uint32_t)(uintptr_t)as ^ (uint32_t)uaddr;
+	h ^= h >> 7;
+	h ^= h >> 13;
+	return &futex_buckets[(h >> 2) % FUTEX_NBUCKETS];
+}
+
+/*
+ * Take FW off the bucket's list. Bucket spinlock must be held.
+ */
+static
+void
+futex_unlink(struct futex_bucket *fb, struct futex_waiter *fw)
+{
+	struct futex_waiter **pp;
+
+	for (pp = &fb->fb_waiters; *pp != NULL; pp = &(*pp)->fw_next) {
+		if (*pp == fw) {
+			*pp = fw->fw_next;
+			return;
+		}
+	}
+	panic("futex: waiter %p not on its list\n", fw);
+}
+
+void
+futex_bootstrap(void)
+{
+	struct futex_bucket *fb;
+	unsigned i;
+
+	for (i=0; i<FUTEX_NBUCKETS; i++) {
+		fb = &futex_buckets[i];
+		fb->fb_lock = lock_create("futex");
+		fb->fb_wchan = wchan_create("futex");
+		if (fb->fb_lock == NULL || fb->fb_wchan == NULL) {
+			panic("futex_bootstrap: out of memory\n");
+		}
+		spinlock_init(&fb->fb_spinlock);
+		fb->fb_waiters = NULL;
+	}
+}
+
+int
+futex_wait(struct addrspace *as, vaddr_t uaddr, uint32_t expected,
+	   unsigned ticks)
+{
+	struct futex_bucket *fb;
+	struct futex_waiter fw;
+	uint32_t val;
+	int result;
+
+	if (uaddr % sizeof(uint32_t) != 0) {
+		return EINVAL;
+	}
+
+	fb = futex_hash(as, uaddr);
+	lock_acquire(fb->fb_lock);
+
+	result = copyin((const_userptr_t)uaddr, &val, sizeof(val));
+	if (result) {
+		lock_release(fb->fb_lock);
+		return result;
+	}
+	if (val != expected) {
+		lock_release(fb->fb_lock);
+		return EAGAIN;
+	}
+
+	fw.fw_as = as;
+	fw.fw_uaddr = uaddr;
+	fw.fw_thread = curthread;
+
+	spinlock_acquire(&fb->fb_spinlock);
+	fw.fw_next = fb->fb_waiters;
+	fb->fb_waiters = &fw;
+	lock_release(fb->fb_lock);
+
+	if (ticks == 0) {
+		wchan_sleep(fb->fb_wchan, &fb->fb_spinlock);
+	}
+	else {
+		result = wchan_sleep_timeout(fb->fb_wchan, &fb->fb_spinlock,
+					     ticks);
+		if (result) {
+			/* Nobody took us off the list; do it ourselves. */
+			futex_unlink(fb, &fw);
+		}
+	}
+	spinlock_release(&fb->fb_spinlock);
+
+	return result;
+}
+
+void
+futex_wake(struct addrspace *as, vaddr_t uaddr, unsigned n, unsigned *woken)
+{
+	struct futex_bucket *fb;
+	struct futex_waiter **pp, *fw;
+
+	*woken = 0;
+	fb = futex_hash(as, uaddr);
+
+	lock_acquire(fb->fb_lock);
+	spinlock_acquire(&fb->fb_spinlock);
+	pp = &fb->fb_waiters;
+	while (*woken < n && (fw = *pp) != NULL) {
+		if (fw->fw_as != as || fw->fw_uaddr != uaddr ||
+		    !wchan_wakethread(fb->fb_wchan, fw->fw_thread,
+				      &fb->fb_spinlock)) {
+			/*
+			 * Someone else's, or timed out and about to
+			 * unlink itself.
+			 */
+			pp = &fw->fw_next;
+			continue;
+		}
+		*pp = fw->fw_next;
+		(*woken)++;
+	}
+	spinlock_release(&fb->fb_spinlock);
+	lock_release(fb->fb_lock);
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Lock contention profiler. See lockstat.h.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <spl.h>
+#include <spinlock.h>
+#include <membar.h>
+#include <clock.h>
+#include <lockstat.h>
+
+/* Size of the table; a power of two. */
+#define LOCKSTAT_NENTRIES   128
+
+/* Names longer than this are cut off (and so may be merged). */
+#define LOCKSTAT_NAMELEN    24
+
+struct lockstat_entry {
+	char le_name[LOCKSTAT_NAMELEN];	/* empty if the slot is unused */
+	int le_kind;			/* LOCKSTAT_* */
+	unsigned le_events;		/* contended acquisitions */
+	uint64_t le_total;		/* spins, or nanoseconds waited */
+	uint64_t le_max;		/* worst single acquisition */
+};
+
+volatile bool lockstat_enabled = false;
+
+static struct lockstat_entry lockstat_table[LOCKSTAT_NENTRIES];
+static unsigned lockstat_dropped;
+
+/*
+ * The table is protected by a bare lock word rather than a struct
+ * spinlock, because spinlock_acquire itself reports here; using a
+ * spinlock would recurse.
+ */
+static volatile spinlock_data_t lockstat_lockword = SPINLOCK_DATA_INITIALIZER;
+
+static
+int
+lockstat_lock(void)
+{
+	int s;
+
+	s = splhigh();
+	while (spinlock_data_get(&lockstat_lockword) != 0 ||
+	       spinlock_data_testandset(&lockstat_lockword) != 0) {
+		/* spin */
+	}
+	membar_store_any();
+	return s;
+}
+
+static
+void
+lockstat_unlock(int s)
+{
+	membar_any_store();
+	spinlock_data_set(&lockstat_lockword, 0);
+	splx(s);
+}
+
+/*
+ * Compare NAME against an entry's name, as cut off to fit.
+ */
+static
+bool
+lockstat_samename(const char *entryname, const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < LOCKSTAT_NAMELEN - 1; i++) {
+		if (entryname[i] != name[i]) {
+			return false;
+		}
+		if (name[i] == '\0') {
+			return true;
+		}
+	}
+	return true;
+}
+
+/*
+ * Find (or make) the entry for NAME and KIND. Call with the table
+ * locked. Returns NULL if the table is full.
+ */
+static
+struct lockstat_entry *
+lockstat_find(int kind, const char *name)
+{
+	struct lockstat_entry *le;
+	unsigned hash, i, slot, len;
+	const char *p;
+
+	if (name == NULL || name[0] == '\0') {
+		name = "(unnamed)";
+	}
+
+	hash = kind;
+	for (p = name; *p != '\0' && p < name + LOCKSTAT_NAMELEN - 1; p++) {
+		hash = hash * 33 + (unsigned char)*p;
+	}
+
+	for (i = 0; i < LOCKSTAT_NENTRIES; i++) {
+		slot = (hash + i) & (LOCKSTAT_NENTRIES - 1);
+		le = &lockstat_table[slot];
+		if (le->le_name[0] == '\0') {
+			len = p - name;
+			memcpy(le->le_name, name, len);
+			le->le_name[len] = '\0';
+			le->le_kind = kind;
+			return le;
+		}
+		if (le->le_kind == kind &&
+		    lockstat_samename(le->le_name, name)) {
+			return le;
+		}
+	}
+	return NULL;
+}
+
+static
+void
+lockstat_record(int kind, const char *name, uint64_t amount)
+{
+	struct lockstat_entry *le;
+	int s;
+
+	s = lockstat_lock();
+	le = lockstat_find(kind, name);
+	if (le == NULL) {
+		lockstat_dropped++;
+	}
+	else {
+		le->le_events++;
+		le->le_total += amount;
+		if (amount > le->le_max) {
+			le->le_max = amount;
+		}
+	}
+	lockstat_unlock(s);
+}
+
+void
+lockstat_spin(const char *name, unsigned spins)
+{
+	if (!lockstat_enabled) {
+		return;
+	}
+	lockstat_record(LOCKSTAT_SPIN, name, spins);
+}
+
+void
+lockstat_wait(int kind, const char *name, const struct timespec *start)
+{
+	struct timespec now, diff;
+
+	if (!lockstat_enabled) {
+		return;
+	}
+	gettime(&now);
+	timespec_sub(&now, start, &diff);
+	lockstat_record(kind, name,
+			(uint64_t)diff.tv_sec * 1000000000 + diff.tv_nsec);
+}
+
+void
+lockstat_start(void)
+{
+	lockstat_enabled = true;
+}
+
+void
+lockstat_stop(void)
+{
+	lockstat_enabled = false;
+}
+
+void
+lockstat_reset(void)
+{
+	int s;
+
+	s = lockstat_lock();
+	bzero(lockstat_table, sizeof(lockstat_table));
+	lockstat_dropped = 0;
+	lockstat_unlock(s);
+}
+
+void
+lockstat_dump(void)
+{
+	static const char *const kindnames[] = { "spin", "lock", "sem", "cv" };
+	static struct lockstat_entry snap[LOCKSTAT_NENTRIES];
+	struct lockstat_entry tmp;
+	unsigned i, j, n, dropped;
+	int s;
+
+	/*
+	 * Copy the used entries out so we don't print with the table
+	 * locked, then sort them by total, biggest first. The snapshot
+	 * is static because it's too big for the kernel stack; the menu
+	 * only runs one command at a time.
+	 */
+	s = lockstat_lock();
+	n = 0;
+	for (i = 0; i < LOCKSTAT_NENTRIES; i++) {
+		if (lockstat_table[i].le_name[0] != '\0') {
+			snap[n++] = lockstat_table[i];
+		}
+	}
+	dropped = lockstat_dropped;
+	lockstat_unlock(s);
+
+	for (i = 1; i < n; i++) {
+		tmp = snap[i];
+		for (j = i; j > 0 && snap[j-1].le_total < tmp.le_total; j--) {
+			snap[j] = snap[j-1];
+		}
+		snap[j] = tmp;
+	}
+
+	kprintf("lockstat: profiling is %s\n",
+		lockstat_enabled ? "on" : "off");
+	kprintf("%-4s %-23s %10s %14s %12s %12s\n",
+		"kind", "name", "contended", "total", "avg", "max");
+	for (i = 0; i < n; i++) {
+		kprintf("%-4s %-23s %10u %14llu %12llu %12llu\n",
+			kindnames[snap[i].le_kind], snap[i].le_name,
+			snap[i].le_events,
+			(unsigned long long)snap[i].le_total,
+			(unsigned long long)(snap[i].le_total /
+					     snap[i].le_events),
+			(unsigned long long)snap[i].le_max);
+	}
+	kprintf("(spin totals are loop iterations; others are nanoseconds)\n");
+	if (dropped > 0) {
+		kprintf("%u events dropped; table full\n", dropped);
+	}
+}
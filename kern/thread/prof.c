@@ -0,0 +1,519 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Sampling profiler. See prof.h.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/fcntl.h>
+#include <lib.h>
+#include <membar.h>
+#include <cpu.h>
+#include <thread.h>
+#include <current.h>
+#include <proc.h>
+#include <clock.h>
+#include <uio.h>
+#include <vfs.h>
+#include <vnode.h>
+#include <elf.h>
+#include <prof.h>
+
+#define PROF_NAMELEN    32	/* longest function name we print */
+#define PROF_MAXPIDS    16	/* distinct pids in the user histogram */
+#define PROF_SYMCHUNK   64	/* symbols read from the ELF file at once */
+
+static volatile bool prof_enabled;
+
+/* One line of the kernel histogram. */
+struct prof_top {
+	uint32_t pt_addr;
+	uint32_t pt_nameoff;
+	unsigned pt_count;
+	char pt_name[PROF_NAMELEN];
+};
+
+////////////////////////////////////////////////////////////
+// Collecting
+
+void
+prof_sample(vaddr_t pc, bool user)
+{
+	struct prof_ring *r;
+	struct prof_sample *ps;
+	struct proc *p;
+
+	if (!prof_enabled) {
+		return;
+	}
+	r = curcpu->c_profring;
+	if (r == NULL) {
+		return;
+	}
+
+	ps = &r->pr_samples[r->pr_total % PROF_RINGSIZE];
+	p = curthread->t_proc;
+	ps->ps_pc = pc;
+	ps->ps_pid = (p == NULL || p == kproc) ? 0 : p->p_process_id;
+	ps->ps_cpu = curcpu->c_number;
+	ps->ps_user = user ? 1 : 0;
+	r->pr_total++;
+}
+
+int
+prof_start(void)
+{
+	struct prof_ring *r;
+	struct cpu *c;
+	unsigned i;
+
+	prof_enabled = false;
+	membar_any_any();
+
+	/*
+	 * Rings are allocated the first time and kept, so a cpu that
+	 * has just seen prof_enabled go false never has its ring
+	 * pulled out from under it.
+	 */
+	for (i=0; i<cpu_count(); i++) {
+		c = cpu_get(i);
+		if (c->c_profring == NULL) {
+			r = kmalloc(sizeof(*r));
+			if (r == NULL) {
+				return ENOMEM;
+			}
+			c->c_profring = r;
+		}
+		c->c_profring->pr_total = 0;
+	}
+
+	membar_any_any();
+	prof_enabled = true;
+	return 0;
+}
+
+void
+prof_stop(void)
+{
+	prof_enabled = false;
+	membar_any_any();
+}
+
+/*
+ * Copy everything in the rings into one array. Works while sampling
+ * is on, but then the newest samples on each cpu may be half-written.
+ */
+static
+struct prof_sample *
+prof_collect(unsigned *ret_n, unsigned *ret_lost)
+{
+	struct prof_sample *all;
+	struct prof_ring *r;
+	unsigned i, j, n, total, have, pos;
+
+	n = 0;
+	for (i=0; i<cpu_count(); i++) {
+		r = cpu_get(i)->c_profring;
+		if (r != NULL) {
+			n += r->pr_total < PROF_RINGSIZE ?
+				r->pr_total : PROF_RINGSIZE;
+		}
+	}
+	/* If this fails, *RET_N still says how many there were. */
+	*ret_n = n;
+	*ret_lost = 0;
+	if (n == 0) {
+		return NULL;
+	}
+
+	all = kmalloc(n * sizeof(*all));
+	if (all == NULL) {
+		return NULL;
+	}
+
+	pos = 0;
+	for (i=0; i<cpu_count() && pos < n; i++) {
+		r = cpu_get(i)->c_profring;
+		if (r == NULL) {
+			continue;
+		}
+		total = r->pr_total;
+		have = total < PROF_RINGSIZE ? total : PROF_RINGSIZE;
+		if (have > n - pos) {
+			have = n - pos;
+		}
+		*ret_lost += total - have;
+		/* oldest first */
+		for (j=0; j<have; j++) {
+			all[pos++] = r->pr_samples[(total - have + j) %
+						   PROF_RINGSIZE];
+		}
+	}
+	*ret_n = pos;
+	return all;
+}
+
+////////////////////////////////////////////////////////////
+// Symbolizing
+
+/* Index of the first element of sorted A that is >= VAL. */
+static
+unsigned
+prof_lowerbound(const uint32_t *a, unsigned n, uint32_t val)
+{
+	unsigned lo = 0, hi = n, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (a[mid] < val) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/* Put an entry into TOP, which is kept sorted by count, biggest first. */
+static
+void
+prof_topinsert(struct prof_top *top, unsigned ntop, uint32_t addr,
+	       uint32_t nameoff, unsigned count)
+{
+	unsigned i;
+
+	if (ntop == 0 || count <= top[ntop-1].pt_count) {
+		return;
+	}
+	for (i = ntop-1; i > 0 && top[i-1].pt_count < count; i--) {
+		top[i] = top[i-1];
+	}
+	top[i].pt_addr = addr;
+	top[i].pt_nameoff = nameoff;
+	top[i].pt_count = count;
+	top[i].pt_name[0] = 0;
+}
+
+static
+int
+prof_readat(struct vnode *vn, off_t pos, void *buf, size_t len)
+{
+	struct iovec iov;
+	struct uio ku;
+	int result;
+
+	uio_kinit(&iov, &ku, buf, len, pos, UIO_READ);
+	result = VOP_READ(vn, &ku);
+	if (result) {
+		return result;
+	}
+	if (ku.uio_resid != 0) {
+		return EIO;
+	}
+	return 0;
+}
+
+/*
+ * Attribute the sorted kernel PCs to the functions in the symbol table
+ * of the ELF file PATH, filling in TOP with the busiest. Sets
+ * *ATTRIBUTED to the number of PCs that fell inside some function.
+ */
+static
+int
+prof_symbolize(const char *path, const uint32_t *pcs, unsigned npcs,
+	       struct prof_top *top, unsigned ntop, unsigned *attributed)
+{
+	char *pathbuf;
+	struct vnode *vn;
+	Elf_Ehdr eh;
+	Elf_Shdr symtab, strtab;
+	Elf_Sym *syms;
+	uint32_t off, chunk, end;
+	unsigned i, j, lo, hi;
+	bool found;
+	int result;
+
+	*attributed = 0;
+
+	/* vfs_open mangles its argument */
+	pathbuf = kstrdup(path);
+	if (pathbuf == NULL) {
+		return ENOMEM;
+	}
+	result = vfs_open(pathbuf, O_RDONLY, 0, &vn);
+	kfree(pathbuf);
+	if (result) {
+		return result;
+	}
+
+	syms = kmalloc(PROF_SYMCHUNK * sizeof(*syms));
+	if (syms == NULL) {
+		vfs_close(vn);
+		return ENOMEM;
+	}
+
+	result = prof_readat(vn, 0, &eh, sizeof(eh));
+	if (result) {
+		goto out;
+	}
+	if (eh.e_ident[EI_MAG0] != ELFMAG0 || eh.e_ident[EI_MAG1] != ELFMAG1 ||
+	    eh.e_ident[EI_MAG2] != ELFMAG2 || eh.e_ident[EI_MAG3] != ELFMAG3 ||
+	    eh.e_shentsize != sizeof(Elf_Shdr)) {
+		result = ENOEXEC;
+		goto out;
+	}
+
+	/* Find the symbol table, and the string table it uses. */
+	found = false;
+	for (i=0; i<eh.e_shnum; i++) {
+		result = prof_readat(vn, eh.e_shoff + i * sizeof(Elf_Shdr),
+				     &symtab, sizeof(symtab));
+		if (result) {
+			goto out;
+		}
+		if (symtab.sh_type == SHT_SYMTAB) {
+			found = true;
+			break;
+		}
+	}
+	if (!found || symtab.sh_link >= eh.e_shnum) {
+		/* stripped */
+		result = ENOENT;
+		goto out;
+	}
+	result = prof_readat(vn, eh.e_shoff + symtab.sh_link * sizeof(Elf_Shdr),
+			     &strtab, sizeof(strtab));
+	if (result) {
+		goto out;
+	}
+
+	/* Go through the symbols a chunk at a time. */
+	end = symtab.sh_size - symtab.sh_size % sizeof(Elf_Sym);
+	for (off = 0; off < end; off += chunk) {
+		chunk = end - off;
+		if (chunk > PROF_SYMCHUNK * sizeof(Elf_Sym)) {
+			chunk = PROF_SYMCHUNK * sizeof(Elf_Sym);
+		}
+		result = prof_readat(vn, symtab.sh_offset + off, syms, chunk);
+		if (result) {
+			goto out;
+		}
+		for (j=0; j < chunk / sizeof(Elf_Sym); j++) {
+			if (ELF32_ST_TYPE(syms[j].st_info) != STT_FUNC ||
+			    syms[j].st_size == 0) {
+				continue;
+			}
+			lo = prof_lowerbound(pcs, npcs, syms[j].st_value);
+			hi = prof_lowerbound(pcs, npcs,
+					syms[j].st_value + syms[j].st_size);
+			if (hi > lo) {
+				*attributed += hi - lo;
+				prof_topinsert(top, ntop, syms[j].st_value,
+					       syms[j].st_name, hi - lo);
+			}
+		}
+	}
+
+	/* Now just the names we need. */
+	for (i=0; i<ntop && top[i].pt_count > 0; i++) {
+		struct iovec iov;
+		struct uio ku;
+
+		uio_kinit(&iov, &ku, top[i].pt_name, PROF_NAMELEN - 1,
+			  strtab.sh_offset + top[i].pt_nameoff, UIO_READ);
+		result = VOP_READ(vn, &ku);
+		if (result) {
+			goto out;
+		}
+		top[i].pt_name[PROF_NAMELEN - 1 - ku.uio_resid] = 0;
+	}
+	result = 0;
+
+ out:
+	kfree(syms);
+	vfs_close(vn);
+	return result;
+}
+
+////////////////////////////////////////////////////////////
+// Reporting
+
+void
+prof_dump(unsigned nfuncs, const char *kernelpath)
+{
+	struct prof_sample *all;
+	struct prof_top *top;
+	uint32_t *pcs;
+	unsigned n, lost, nk, i, j, attributed;
+	pid_t pids[PROF_MAXPIDS];
+	unsigned pidcounts[PROF_MAXPIDS], npids, otherpids;
+	int result;
+
+	if (prof_enabled) {
+		kprintf("prof: still sampling; the newest samples may be off\n");
+	}
+
+	all = prof_collect(&n, &lost);
+	if (all == NULL) {
+		kprintf("prof: %s\n", n > 0 ? "out of memory" : "no samples");
+		return;
+	}
+
+	pcs = kmalloc(n * sizeof(*pcs));
+	top = kmalloc(nfuncs * sizeof(*top));
+	if (pcs == NULL || top == NULL) {
+		kprintf("prof: out of memory\n");
+		goto done;
+	}
+
+	/* Split into kernel PCs and a per-pid tally of user samples. */
+	nk = npids = otherpids = 0;
+	for (i=0; i<n; i++) {
+		if (!all[i].ps_user) {
+			pcs[nk++] = all[i].ps_pc;
+			continue;
+		}
+		for (j=0; j<npids && pids[j] != all[i].ps_pid; j++) {
+			/* nothing */
+		}
+		if (j == npids) {
+			if (npids == PROF_MAXPIDS) {
+				otherpids++;
+				continue;
+			}
+			pids[npids] = all[i].ps_pid;
+			pidcounts[npids] = 0;
+			npids++;
+		}
+		pidcounts[j]++;
+	}
+
+	kprintf("%u samples (%u kernel, %u user) at %u Hz per cpu, "
+		"%u overwritten\n", n, nk, n - nk, HZ, lost);
+
+	/* Kernel histogram. */
+	sort_uint32(pcs, nk);
+	for (i=0; i<nfuncs; i++) {
+		top[i].pt_count = 0;
+	}
+	result = prof_symbolize(kernelpath, pcs, nk, top, nfuncs,
+				&attributed);
+	if (result) {
+		/* No symbols; show the hottest individual PCs instead. */
+		kprintf("prof: no symbols from %s (%s); showing raw PCs\n",
+			kernelpath, strerror(result));
+		for (i=0; i<nk; i=j) {
+			for (j=i; j<nk && pcs[j] == pcs[i]; j++) {
+				/* nothing */
+			}
+			prof_topinsert(top, nfuncs, pcs[i], 0, j - i);
+		}
+		attributed = nk;
+	}
+	kprintf("\n   samples      %%  address     function\n");
+	for (i=0; i<nfuncs && top[i].pt_count > 0; i++) {
+		kprintf("%10u %5u%%  0x%08x  %s\n", top[i].pt_count,
+			top[i].pt_count * 100 / nk, top[i].pt_addr,
+			top[i].pt_name);
+	}
+	if (attributed < nk) {
+		kprintf("%10u %5u%%  (not in any function)\n",
+			nk - attributed, (nk - attributed) * 100 / nk);
+	}
+
+	/* User histogram. */
+	if (n > nk) {
+		kprintf("\n   samples      %%  pid (user mode)\n");
+		for (i=0; i<npids; i++) {
+			kprintf("%10u %5u%%  %d\n", pidcounts[i],
+				pidcounts[i] * 100 / (n - nk), (int)pids[i]);
+		}
+		if (otherpids > 0) {
+			kprintf("%10u %5u%%  (others)\n", otherpids,
+				otherpids * 100 / (n - nk));
+		}
+	}
+
+ done:
+	kfree(top);
+	kfree(pcs);
+	kfree(all);
+}
+
+int
+prof_save(const char *path)
+{
+	char *pathbuf;
+	struct prof_filehdr hdr;
+	struct prof_sample *all;
+	struct vnode *vn;
+	struct iovec iov;
+	struct uio ku;
+	unsigned n, lost;
+	int result;
+
+	all = prof_collect(&n, &lost);
+	if (all == NULL && n > 0) {
+		return ENOMEM;
+	}
+
+	pathbuf = kstrdup(path);
+	if (pathbuf == NULL) {
+		kfree(all);
+		return ENOMEM;
+	}
+	result = vfs_open(pathbuf, O_WRONLY|O_CREAT|O_TRUNC, 0664, &vn);
+	kfree(pathbuf);
+	if (result) {
+		kfree(all);
+		return result;
+	}
+
+	hdr.pf_magic = PROF_MAGIC;
+	hdr.pf_hz = HZ;
+	hdr.pf_nsamples = n;
+	hdr.pf_lost = lost;
+	uio_kinit(&iov, &ku, &hdr, sizeof(hdr), 0, UIO_WRITE);
+	result = VOP_WRITE(vn, &ku);
+	if (result == 0 && n > 0) {
+		uio_kinit(&iov, &ku, all, n * sizeof(*all), sizeof(hdr),
+			  UIO_WRITE);
+		result = VOP_WRITE(vn, &ku);
+	}
+
+	vfs_close(vn);
+	kfree(all);
+	if (result == 0) {
+		kprintf("prof: wrote %u samples to %s\n", n, path);
+	}
+	return result;
+}
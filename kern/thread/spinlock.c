@@ -38,11 +38,25 @@
 #include <spinlock.h>
 #include <membar.h>
 #include <current.h>	/* for curcpu */
+#include <lockstat.h>
 
 /*
  * Spinlocks.
  */
 
+/*
+ * Burn some cycles without touching the lock word.
+ */
+static
+void
+spinlock_delay(unsigned n)
+{
+	volatile unsigned i;
+
+	for (i=0; i<n; i++) {
+		/* nothing */
+	}
+}
 
 /*
  * Initialize spinlock.
@@ -51,7 +65,11 @@ void
 spinlock_init(struct spinlock *splk)
 {
 	spinlock_data_set(&splk->splk_lock, 0);
+	spinlock_data_set(&splk->splk_next, 0);
+	spinlock_data_set(&splk->splk_serving, 0);
 	splk->splk_holder = NULL;
+	splk->splk_name = NULL;
+	splk->splk_kind = SPINLOCK_TTAS;
 }
 
 /*
@@ -62,6 +80,8 @@ spinlock_cleanup(struct spinlock *splk)
 {
 	KASSERT(splk->splk_holder == NULL);
 	KASSERT(spinlock_data_get(&splk->splk_lock) == 0);
+	KASSERT(spinlock_data_get(&splk->splk_next) ==
+		spinlock_data_get(&splk->splk_serving));
 }
 
 /*
@@ -75,6 +95,7 @@ void
 spinlock_acquire(struct spinlock *splk)
 {
 	struct cpu *mycpu;
+	unsigned spins = 0;
 
 	splraise(IPL_NONE, IPL_HIGH);
 
@@ -90,28 +111,67 @@ spinlock_acquire(struct spinlock *splk)
 		mycpu = NULL;
 	}
 
-	while (1) {
+	if (splk->splk_kind == SPINLOCK_TICKET) {
+		spinlock_data_t ticket, dist;
+
 		/*
-		 * Do test-test-and-set, that is, read first before
-		 * doing test-and-set, to reduce bus contention.
-		 *
-		 * Test-and-set is a machine-level atomic operation
-		 * that writes 1 into the lock word and returns the
-		 * previous value. If that value was 0, the lock was
-		 * previously unheld and we now own it. If it was 1,
-		 * we don't.
+		 * Take a number, then wait for it to come up. Each
+		 * waiter only reads splk_serving, and only the holder
+		 * writes it, so there's no LL/SC traffic while
+		 * waiting. Back off in proportion to the number of
+		 * CPUs ahead of us, since each of them will hold the
+		 * lock for a while before it's our turn.
 		 */
-		if (spinlock_data_get(&splk->splk_lock) != 0) {
-			continue;
+		ticket = spinlock_data_fetchadd(&splk->splk_next, 1);
+		while (1) {
+			dist = ticket - spinlock_data_get(&splk->splk_serving);
+			if (dist == 0) {
+				break;
+			}
+			spins++;
+			if (dist > 1) {
+				dist = (dist - 1) * SPINLOCK_BACKOFF_MIN;
+				spinlock_delay(dist > SPINLOCK_BACKOFF_MAX ?
+					       SPINLOCK_BACKOFF_MAX : dist);
+			}
 		}
-		if (spinlock_data_testandset(&splk->splk_lock) != 0) {
-			continue;
+	}
+	else {
+		unsigned backoff = SPINLOCK_BACKOFF_MIN;
+
+		while (1) {
+			/*
+			 * Do test-test-and-set, that is, read first
+			 * before doing test-and-set, to reduce bus
+			 * contention.
+			 *
+			 * Test-and-set is a machine-level atomic
+			 * operation that writes 1 into the lock word
+			 * and returns the previous value. If that
+			 * value was 0, the lock was previously unheld
+			 * and we now own it. If it was 1, we don't.
+			 */
+			if (spinlock_data_get(&splk->splk_lock) == 0 &&
+			    spinlock_data_testandset(&splk->splk_lock) == 0) {
+				break;
+			}
+			spins++;
+			if (splk->splk_kind == SPINLOCK_BACKOFF) {
+				/* Lost; stay off the bus for a while. */
+				spinlock_delay(backoff);
+				if (backoff < SPINLOCK_BACKOFF_MAX) {
+					backoff *= 2;
+				}
+			}
 		}
-		break;
 	}
 
 	membar_store_any();
 	splk->splk_holder = mycpu;
+
+	if (spins > 0 && lockstat_enabled) {
+		lockstat_spin(splk->splk_name, spins);
+	}
 }
 
 /*
@@ -129,7 +189,14 @@ spinlock_release(struct spinlock *splk)
 
 	splk->splk_holder = NULL;
 	membar_any_store();
-	spinlock_data_set(&splk->splk_lock, 0);
+	if (splk->splk_kind == SPINLOCK_TICKET) {
+		/* Only the holder writes this, so no atomic op needed. */
+		spinlock_data_set(&splk->splk_serving,
+				  spinlock_data_get(&splk->splk_serving) + 1);
+	}
+	else {
+		spinlock_data_set(&splk->splk_lock, 0);
+	}
 	spllower(IPL_HIGH, IPL_NONE);
 }
 
@@ -146,3 +213,25 @@ spinlock_do_i_hold(struct spinlock *splk)
 	/* Assume we can read splk_holder atomically enough for this to work */
 	return (splk->splk_holder == curcpu->c_self);
 }
+
+/*
+ * Name the lock for lockstat.
+ */
+void
+spinlock_setname(struct spinlock *splk, const char *name)
+{
+	splk->splk_name = name;
+}
+
+/*
+ * Choose the acquire algorithm.
+ */
+void
+spinlock_setkind(struct spinlock *splk, spinlock_kind_t kind)
+{
+	KASSERT(splk->splk_holder == NULL);
+	KASSERT(spinlock_data_get(&splk->splk_lock) == 0);
+	KASSERT(spinlock_data_get(&splk->splk_next) ==
+		spinlock_data_get(&splk->splk_serving));
+	splk->splk_kind = kind;
+}
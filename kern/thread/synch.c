@@ -38,6 +38,8 @@
 #include <wchan.h>
 #include <thread.h>
 #include <current.h>
+#include <clock.h>
+#include <lockstat.h>
 #include <synch.h>
 
 ////////////////////////////////////////////////////////////
@@ -69,6 +71,8 @@ sem_create(const char *name, unsigned initial_count)
 
 	spinlock_init(&sem->sem_lock);
         sem->sem_count = initial_count;
+        sem->sem_handoff = false;
+        sem->sem_granted = 0;
 
         return sem;
 }
@@ -98,8 +102,15 @@ P(struct semaphore *sem)
          */
         KASSERT(curthread->t_in_interrupt == false);
 
+        struct timespec waitstart;
+        bool profiling = false;
+
 	/* Use the semaphore spinlock to protect the wchan as well. */
 	spinlock_acquire(&sem->sem_lock);
+        if (sem->sem_count == 0 && lockstat_enabled) {
+                gettime(&waitstart);
+                profiling = true;
+        }
         while (sem->sem_count == 0) {
 		/*
 		 *
@@ -110,14 +121,26 @@ P(struct semaphore *sem)
 		 * textbooks semaphores must for some reason have
 		 * strict ordering. Too bad. :-)
 		 *
-		 * Exercise: how would you implement strict FIFO
-		 * ordering?
+		 * Unless the semaphore is in handoff mode: then V
+		 * doesn't raise the count while anyone is waiting, it
+		 * wakes the first waiter and counts a grant for it.
+		 * Only threads woken that way pick up grants, one
+		 * each, so nobody can barge in ahead of them.
 		 */
 		wchan_sleep(sem->sem_wchan, &sem->sem_lock);
+		if (sem->sem_granted > 0) {
+			sem->sem_granted--;
+			goto granted;
+		}
         }
         KASSERT(sem->sem_count > 0);
         sem->sem_count--;
+ granted:
 	spinlock_release(&sem->sem_lock);
+
+        if (profiling) {
+                lockstat_wait(LOCKSTAT_SEM, sem->sem_name, &waitstart);
+        }
 }
 
 void
@@ -127,17 +150,40 @@ V(struct semaphore *sem)
 
 	spinlock_acquire(&sem->sem_lock);
 
-        sem->sem_count++;
-        KASSERT(sem->sem_count > 0);
+        if (sem->sem_handoff && !wchan_isempty(sem->sem_wchan, &sem->sem_lock)) {
+                sem->sem_granted++;
+        }
+        else {
+                sem->sem_count++;
+                KASSERT(sem->sem_count > 0);
+        }
 	wchan_wakeone(sem->sem_wchan, &sem->sem_lock);
 
 	spinlock_release(&sem->sem_lock);
 }
 
+void
+sem_sethandoff(struct semaphore *sem, bool handoff)
+{
+        KASSERT(sem != NULL);
+
+	spinlock_acquire(&sem->sem_lock);
+        sem->sem_handoff = handoff;
+	spinlock_release(&sem->sem_lock);
+}
+
 ////////////////////////////////////////////////////////////
 //
 // Lock.
 
+/*
+ * Adaptive spinning: how many times lock_acquire will go around its
+ * spin loop waiting for an on-CPU owner before giving up and
+ * sleeping, and how often it rechecks that the owner is still on-CPU.
+ */
+#define LOCK_SPIN_MAX       1000
+#define LOCK_SPIN_RECHECK   50
+
 struct lock *
 lock_create(const char *name)
 {
@@ -167,6 +213,9 @@ lock_create(const char *name)
         spinlock_init(&lock->lk_spinlock);
         lock->lk_owner = NULL;
         lock->lk_flag = false;
+        bzero(&lock->lk_stats, sizeof(lock->lk_stats));
+        lock->lk_handoff = false;
+        lock->lk_granted = false;
 
         KASSERT(lock->lk_owner == false);
 
@@ -187,43 +236,124 @@ lock_destroy(struct lock *lock)
         kfree(lock);
 }
 
+/*
+ * Check if the holder of LOCK is currently running on a CPU, in
+ * which case it is worth spinning for a while. Must be called with
+ * lk_spinlock held; the owner can't go away while it holds the lock.
+ */
+static
+bool
+lock_owner_running(struct lock *lock)
+{
+        KASSERT(spinlock_do_i_hold(&lock->lk_spinlock));
+        return lock->lk_owner != NULL && lock->lk_owner->t_state == S_RUN;
+}
+
 void
 lock_acquire(struct lock *lock)
 {
+        unsigned spins = 0;
+        bool slept = false;
+        struct timespec waitstart;
+        bool profiling = false;
+
         // Write this
         spinlock_acquire(&lock->lk_spinlock);
+
+        lock->lk_stats.ls_acquires++;
+        if (lock->lk_flag == true) {
+            lock->lk_stats.ls_contended++;
+            if (lockstat_enabled) {
+                gettime(&waitstart);
+                profiling = true;
+            }
+        }
         
         /* 
          * Test the lock flag value:
-         * True: the lock is taken, and we should put the current thread to sleep
+         * True: the lock is taken. If the owner is running on another CPU it will
+         *       probably release it soon, so spin (without the spinlock) for a while;
+         *       otherwise put the current thread to sleep
          * False: continue since the lock is free
         */ 
         while(lock->lk_flag == true) {
+            if (spins < LOCK_SPIN_MAX && lock_owner_running(lock)) {
+                spinlock_release(&lock->lk_spinlock);
+                // watch the flag, and go back to recheck the owner every so often
+                do {
+                    spins++;
+                } while (lock->lk_flag == true && spins % LOCK_SPIN_RECHECK != 0);
+                spinlock_acquire(&lock->lk_spinlock);
+                continue;
+            }
+
+            lock->lk_stats.ls_sleeps++;
+            slept = true;
             wchan_sleep(lock->lk_wchan, &lock->lk_spinlock);
+            //in handoff mode, release left the lock held for us; take it over
+            if (lock->lk_granted) {
+                lock->lk_granted = false;
+                goto granted;
+            }
             //when the thread is woken up, we check the while loop guard again to make sure the lock is free
         }
         
         KASSERT(lock->lk_flag == false);
 
+ granted:
+        lock->lk_stats.ls_spins += spins;
+        if (spins > 0 && !slept) {
+            lock->lk_stats.ls_spinwins++;
+        }
+
         lock->lk_flag = true;
         lock->lk_owner = curthread;
         spinlock_release(&lock->lk_spinlock);
 
+        if (profiling) {
+            lockstat_wait(LOCKSTAT_LOCK, lock->lk_name, &waitstart);
+        }
 }
 
 void
 lock_release(struct lock *lock)
 {
     spinlock_acquire(&lock->lk_spinlock);
-    // Release the flag
-    lock->lk_flag = false;
     lock->lk_owner = NULL;
+
+    if (lock->lk_handoff && !wchan_isempty(lock->lk_wchan, &lock->lk_spinlock)) {
+        // Keep the flag set so nobody else can take it; the waiter we wake claims it
+        KASSERT(lock->lk_granted == false);
+        lock->lk_granted = true;
+    }
+    else {
+        // Release the flag
+        lock->lk_flag = false;
+    }
     
     // Wakes one thread in the waitchannel in FIFO order
     wchan_wakeone(lock->lk_wchan, &lock->lk_spinlock);
     spinlock_release(&lock->lk_spinlock);
 }
 
+void
+lock_sethandoff(struct lock *lock, bool handoff)
+{
+    KASSERT(lock != NULL);
+
+    spinlock_acquire(&lock->lk_spinlock);
+    lock->lk_handoff = handoff;
+    spinlock_release(&lock->lk_spinlock);
+}
+
+void
+lock_getstats(struct lock *lock, struct lock_stats *ret)
+{
+        spinlock_acquire(&lock->lk_spinlock);
+        *ret = lock->lk_stats;
+        spinlock_release(&lock->lk_spinlock);
+}
+
 bool
 lock_do_i_hold(struct lock *lock)
 {
@@ -289,6 +419,13 @@ cv_destroy(struct cv *cv)
 void
 cv_wait(struct cv *cv, struct lock *lock)
 {
+    struct timespec waitstart;
+    bool profiling = lockstat_enabled;
+
+    if (profiling) {
+        gettime(&waitstart);
+    }
+
     spinlock_acquire(&cv->cv_spinlock);
     
     // release the lock and put the calling thread to sleep
@@ -299,6 +436,28 @@ cv_wait(struct cv *cv, struct lock *lock)
     // release the spinlock first to avoid deadlock situation
     spinlock_release(&cv->cv_spinlock);
     lock_acquire(lock);
+
+    // charged to the CV: time asleep plus time getting the lock back
+    if (profiling) {
+        lockstat_wait(LOCKSTAT_CV, cv->cv_name, &waitstart);
+    }
+}
+
+int
+cv_timedwait(struct cv *cv, struct lock *lock, unsigned ticks)
+{
+    int result;
+
+    spinlock_acquire(&cv->cv_spinlock);
+
+    // same as cv_wait, but the sleep can end on its own
+    lock_release(lock);
+    result = wchan_sleep_timeout(cv->cv_wchan, &cv->cv_spinlock, ticks);
+
+    spinlock_release(&cv->cv_spinlock);
+    lock_acquire(lock);
+
+    return result;
 }
 
 void
@@ -320,3 +479,160 @@ cv_broadcast(struct cv *cv, struct lock *lock)
     wchan_wakeall(cv->cv_wchan, &cv->cv_spinlock);
     spinlock_release(&cv->cv_spinlock);
 }
+
+////////////////////////////////////////////////////////////
+//
+// Reader-writer lock.
+
+struct rwlock *
+rwlock_create(const char *name)
+{
+        struct rwlock *rwlock;
+
+        rwlock = kmalloc(sizeof(struct rwlock));
+        if (rwlock == NULL) {
+                return NULL;
+        }
+
+        rwlock->rwlock_name = kstrdup(name);
+        if (rwlock->rwlock_name == NULL) {
+                kfree(rwlock);
+                return NULL;
+        }
+
+        rwlock->rw_read_wchan = wchan_create(rwlock->rwlock_name);
+        if (rwlock->rw_read_wchan == NULL) {
+                kfree(rwlock->rwlock_name);
+                kfree(rwlock);
+                return NULL;
+        }
+
+        rwlock->rw_write_wchan = wchan_create(rwlock->rwlock_name);
+        if (rwlock->rw_write_wchan == NULL) {
+                wchan_destroy(rwlock->rw_read_wchan);
+                kfree(rwlock->rwlock_name);
+                kfree(rwlock);
+                return NULL;
+        }
+
+        spinlock_init(&rwlock->rw_spinlock);
+        rwlock->rw_readers = 0;
+        rwlock->rw_writer = NULL;
+        rwlock->rw_waiting_readers = 0;
+        rwlock->rw_waiting_writers = 0;
+        rwlock->rw_read_gen = 0;
+
+        return rwlock;
+}
+
+void
+rwlock_destroy(struct rwlock *rwlock)
+{
+        KASSERT(rwlock != NULL);
+        KASSERT(rwlock->rw_readers == 0);
+        KASSERT(rwlock->rw_writer == NULL);
+
+        spinlock_cleanup(&rwlock->rw_spinlock);
+        wchan_destroy(rwlock->rw_read_wchan);
+        wchan_destroy(rwlock->rw_write_wchan);
+
+        kfree(rwlock->rwlock_name);
+        kfree(rwlock);
+}
+
+void
+rwlock_acquire_read(struct rwlock *rwlock)
+{
+        unsigned gen;
+
+        KASSERT(rwlock != NULL);
+        KASSERT(curthread->t_in_interrupt == false);
+
+        spinlock_acquire(&rwlock->rw_spinlock);
+
+        // fast path: no writer inside and none waiting
+        if (rwlock->rw_writer == NULL && rwlock->rw_waiting_writers == 0) {
+            rwlock->rw_readers++;
+            spinlock_release(&rwlock->rw_spinlock);
+            return;
+        }
+
+        /*
+         * Wait for the next writer release to let us in. It counts us
+         * into rw_readers on our behalf and bumps rw_read_gen, so there
+         * is nothing left for us to do once the generation changes.
+         */
+        rwlock->rw_waiting_readers++;
+        gen = rwlock->rw_read_gen;
+        while (rwlock->rw_read_gen == gen) {
+            wchan_sleep(rwlock->rw_read_wchan, &rwlock->rw_spinlock);
+        }
+        KASSERT(rwlock->rw_readers > 0);
+
+        spinlock_release(&rwlock->rw_spinlock);
+}
+
+void
+rwlock_release_read(struct rwlock *rwlock)
+{
+        KASSERT(rwlock != NULL);
+
+        spinlock_acquire(&rwlock->rw_spinlock);
+
+        KASSERT(rwlock->rw_readers > 0);
+        KASSERT(rwlock->rw_writer == NULL);
+        rwlock->rw_readers--;
+
+        // last reader out lets a writer in
+        if (rwlock->rw_readers == 0 && rwlock->rw_waiting_writers > 0) {
+            wchan_wakeone(rwlock->rw_write_wchan, &rwlock->rw_spinlock);
+        }
+
+        spinlock_release(&rwlock->rw_spinlock);
+}
+
+void
+rwlock_acquire_write(struct rwlock *rwlock)
+{
+        KASSERT(rwlock != NULL);
+        KASSERT(curthread->t_in_interrupt == false);
+
+        spinlock_acquire(&rwlock->rw_spinlock);
+
+        KASSERT(rwlock->rw_writer != curthread);
+
+        // counting ourselves as waiting holds off new readers
+        rwlock->rw_waiting_writers++;
+        while (rwlock->rw_writer != NULL || rwlock->rw_readers > 0) {
+            wchan_sleep(rwlock->rw_write_wchan, &rwlock->rw_spinlock);
+        }
+        rwlock->rw_waiting_writers--;
+        rwlock->rw_writer = curthread;
+
+        spinlock_release(&rwlock->rw_spinlock);
+}
+
+void
+rwlock_release_write(struct rwlock *rwlock)
+{
+        KASSERT(rwlock != NULL);
+
+        spinlock_acquire(&rwlock->rw_spinlock);
+
+        KASSERT(rwlock->rw_writer == curthread);
+        KASSERT(rwlock->rw_readers == 0);
+        rwlock->rw_writer = NULL;
+
+        if (rwlock->rw_waiting_readers > 0) {
+            // let the whole batch of waiting readers in, ahead of other writers
+            rwlock->rw_readers += rwlock->rw_waiting_readers;
+            rwlock->rw_waiting_readers = 0;
+            rwlock->rw_read_gen++;
+            wchan_wakeall(rwlock->rw_read_wchan, &rwlock->rw_spinlock);
+        }
+        else if (rwlock->rw_waiting_writers > 0) {
+            wchan_wakeone(rwlock->rw_write_wchan, &rwlock->rw_spinlock);
+        }
+
+        spinlock_release(&rwlock->rw_spinlock);
+}
@@ -50,6 +50,10 @@
 #include <addrspace.h>
 #include <mainbus.h>
 #include <vnode.h>
+#include <clock.h>
+#include <timer.h>
+#include <workqueue.h>
+#include <trace.h>
 
 #include "opt-synchprobs.h"
 
@@ -57,6 +61,12 @@
 /* Magic number used as a guard value on kernel thread stacks. */
 #define THREAD_STACK_MAGIC 0xbaadf00d
 
+/* How often schedule() boosts every thread back to MLFQ level 0. */
+#define SCHED_BOOST_HARDCLOCKS	HZ	/* Once a second. */
+
+/* How many randomly chosen CPUs an idle CPU looks at when stealing. */
+#define STEAL_PROBES		2
+
 /* Wait channel. A wchan is protected by an associated, passed-in spinlock. */
 struct wchan {
 	const char *wc_name;		/* name for this channel */
@@ -78,6 +88,10 @@ static struct wchanarray allwchans;
 /* Used to wait for secondary CPUs to come online. */
 static struct semaphore *cpu_startup_sem;
 
+/* Work stealing, for idle CPUs; see below. */
+static bool thread_steal(void);
+static void thread_kick_idle(struct cpu *busy);
+
 ////////////////////////////////////////////////////////////
 
 /*
@@ -140,6 +154,7 @@ thread_create(const char *name)
 		return NULL;
 	}
 	thread->t_wchan_name = "NEW";
+	thread->t_wchan = NULL;
 	thread->t_state = S_READY;
 
 	/* Thread subsystem fields */
@@ -150,6 +165,22 @@ thread_create(const char *name)
 	thread->t_cpu = NULL;
 	thread->t_proc = NULL;
 
+	/* Scheduler fields */
+	thread->t_sched_level = 0;
+	thread->t_sched_ticks = 0;
+	thread->t_sched_lastrun = 0;
+	thread->t_sched_pinned = false;
+	thread->t_sched_classpending = false;
+	thread->t_sched_newclass = SCHED_DYNAMIC;
+	thread->t_bound = false;
+	thread->t_slice = 0;
+
+	/* Accounting fields */
+	thread->t_cputime = 0;
+	thread->t_nvcsw = 0;
+	thread->t_nivcsw = 0;
+	thread->t_preempted = false;
+
 	/* Interrupt state fields */
 	thread->t_in_interrupt = false;
 	thread->t_curspl = IPL_HIGH;
@@ -187,10 +218,21 @@ cpu_create(unsigned hardware_number)
 	threadlist_init(&c->c_zombies);
 	c->c_hardclocks = 0;
 	c->c_spinlocks = 0;
+	c->c_sched_lastboost = 0;
+	c->c_steal_seed = 2654435761U * (hardware_number + 1);
+	bzero(c->c_counters, sizeof(c->c_counters));
+	c->c_tickless = false;
+	c->c_tickless_ticks = 0;
 
 	c->c_isidle = false;
 	threadlist_init(&c->c_runqueue);
 	spinlock_init(&c->c_runqueue_lock);
+	spinlock_setname(&c->c_runqueue_lock, "c_runqueue_lock");
+	spinlock_setkind(&c->c_runqueue_lock, SPINLOCK_TICKET);
+	timerwheel_init(&c->c_timerwheel);
+	workqueue_init(&c->c_workqueue);
+	c->c_profring = NULL;
+	c->c_tracering = NULL;
 
 	c->c_ipi_pending = 0;
 	c->c_numshootdown = 0;
@@ -234,6 +276,21 @@ cpu_create(unsigned hardware_number)
 	return c;
 }
 
+/*
+ * Enumerate cpus.
+ */
+unsigned
+cpu_count(void)
+{
+	return cpuarray_num(&allcpus);
+}
+
+struct cpu *
+cpu_get(unsigned num)
+{
+	return cpuarray_get(&allcpus, num);
+}
+
 /*
  * Destroy a thread.
  *
@@ -440,6 +497,67 @@ thread_start_cpus(void)
 	}
 	sem_destroy(cpu_startup_sem);
 	cpu_startup_sem = NULL;
+
+	/* Now everyone's up, give each cpu a deferred-work thread. */
+	for (i=0; i<cpuarray_num(&allcpus); i++) {
+		workqueue_start(cpuarray_get(&allcpus, i));
+	}
+}
+
+/*
+ * Give T scheduling class LEVEL (see thread_set_schedclass). T must
+ * not be on a run queue, since its position there depends on its
+ * level.
+ */
+static
+void
+sched_setclass(struct thread *t, int level)
+{
+	if (level == SCHED_DYNAMIC) {
+		t->t_sched_pinned = false;
+	}
+	else {
+		t->t_sched_pinned = true;
+		t->t_sched_level = level;
+	}
+	t->t_sched_ticks = 0;
+	t->t_sched_classpending = false;
+}
+
+/*
+ * Apply a class change that was made while T was running or asleep.
+ */
+static
+void
+sched_applyclass(struct thread *t)
+{
+	if (t->t_sched_classpending) {
+		sched_setclass(t, t->t_sched_newclass);
+	}
+}
+
+/*
+ * Put T on CPU C's run queue, behind every thread at the same or a
+ * more urgent MLFQ level. This keeps the queue sorted by level and
+ * round-robin within each level. The run queue lock must be held.
+ */
+static
+void
+sched_enqueue(struct cpu *c, struct thread *t)
+{
+	struct thread *prev;
+
+	KASSERT(spinlock_do_i_hold(&c->c_runqueue_lock));
+
+	sched_applyclass(t);
+
+	THREADLIST_FORALL_REV(prev, c->c_runqueue) {
+		if (prev->t_sched_level <= t->t_sched_level) {
+			threadlist_insertafter(&c->c_runqueue, prev, t);
+			return;
+		}
+	}
+	threadlist_addhead(&c->c_runqueue, t);
 }
 
 /*
@@ -466,7 +584,7 @@ thread_make_runnable(struct thread *target, bool already_have_lock)
 
 	/* Target thread is now ready to run; put it on the run queue. */
 	target->t_state = S_READY;
-	threadlist_addtail(&targetcpu->c_runqueue, target);
+	sched_enqueue(targetcpu, target);
 
 	if (targetcpu->c_isidle) {
 		/*
@@ -475,6 +593,14 @@ thread_make_runnable(struct thread *target, bool already_have_lock)
 		 */
 		ipi_send(targetcpu, IPI_UNIDLE);
 	}
+	else if (targetcpu->c_runqueue.tl_count > 1) {
+		/*
+		 * Idle cpus sleep without ticking, so they won't come
+		 * looking for work by themselves. Wake one up to steal
+		 * some of this.
+		 */
+		thread_kick_idle(targetcpu);
+	}
 
 	if (!already_have_lock) {
 		spinlock_release(&targetcpu->c_runqueue_lock);
@@ -488,14 +614,16 @@ thread_make_runnable(struct thread *target, bool already_have_lock)
  * ENTRYPOINT. DATA1 and DATA2 are passed to ENTRYPOINT.
  *
  * The new thread is created in the process P. If P is null, the
- * process is inherited from the caller. It will start on the same CPU
- * as the caller, unless the scheduler intervenes first.
+ * process is inherited from the caller. It will start on CPU C (for
+ * thread_fork, the caller's), unless the scheduler intervenes first;
+ * if BOUND, the scheduler won't.
  */
+static
 int
-thread_fork(const char *name,
-	    struct proc *proc,
-	    void (*entrypoint)(void *data1, unsigned long data2),
-	    void *data1, unsigned long data2)
+thread_fork_on(struct cpu *c, bool bound, const char *name,
+	       struct proc *proc,
+	       void (*entrypoint)(void *data1, unsigned long data2),
+	       void *data1, unsigned long data2)
 {
 	struct thread *newthread;
 	int result;
@@ -518,7 +646,14 @@ thread_fork(const char *name,
 	 */
 
 	/* Thread subsystem fields */
-	newthread->t_cpu = curthread->t_cpu;
+	newthread->t_cpu = c;
+	newthread->t_bound = bound;
+
+	/* Inherit a pinned scheduling class, as Unix children inherit nice */
+	if (curthread->t_sched_pinned) {
+		newthread->t_sched_pinned = true;
+		newthread->t_sched_level = curthread->t_sched_level;
+	}
 
 	/* Attach the new thread to its process */
 	if (proc == NULL) {
@@ -541,12 +676,78 @@ thread_fork(const char *name,
 	/* Set up the switchframe so entrypoint() gets called */
 	switchframe_init(newthread, entrypoint, data1, data2);
 
-	/* Lock the current cpu's run queue and make the new thread runnable */
+	/* Lock the target cpu's run queue and make the new thread runnable */
 	thread_make_runnable(newthread, false);
 
 	return 0;
 }
 
+int
+thread_fork(const char *name,
+	    struct proc *proc,
+	    void (*entrypoint)(void *data1, unsigned long data2),
+	    void *data1, unsigned long data2)
+{
+	return thread_fork_on(curthread->t_cpu, false, name, proc,
+			      entrypoint, data1, data2);
+}
+
+int
+thread_fork_bound(struct cpu *c, const char *name,
+		  struct proc *proc,
+		  void (*entrypoint)(void *data1, unsigned long data2),
+		  void *data1, unsigned long data2)
+{
+	return thread_fork_on(c, true, name, proc, entrypoint, data1, data2);
+}
+
+/*
+ * Charge the current thread for the hardclocks it has run since it
+ * was last dispatched, then move it between MLFQ levels: down one
+ * when it has used up its allotment at its level, up one when it is
+ * going to sleep on a wait channel. Pinned threads stay put.
+ *
+ * Called from thread_switch with the run queue locked.
+ */
+static
+void
+sched_account(struct thread *cur, threadstate_t newstate)
+{
+	cur->t_sched_ticks += curcpu->c_hardclocks - cur->t_sched_lastrun;
+	cur->t_sched_lastrun = curcpu->c_hardclocks;
+
+	sched_applyclass(cur);
+	if (cur->t_sched_pinned) {
+		return;
+	}
+
+	if (newstate == S_SLEEP) {
+		if (cur->t_sched_level > 0) {
+			cur->t_sched_level--;
+		}
+		cur->t_sched_ticks = 0;
+	}
+	else if (cur->t_sched_ticks >= SCHED_ALLOTMENT(cur->t_sched_level)) {
+		if (cur->t_sched_level < SCHED_NLEVELS - 1) {
+			cur->t_sched_level++;
+		}
+		cur->t_sched_ticks = 0;
+	}
+}
+
+/*
+ * PID to record for a thread in the trace; kernel-only threads are 0.
+ */
+static
+uint32_t
+thread_tracepid(struct thread *t)
+{
+	if (t->t_proc == NULL || t->t_proc == kproc) {
+		return 0;
+	}
+	return t->t_proc->p_process_id;
+}
+
 /*
  * High level, machine-independent context switch code.
  *
@@ -587,8 +788,12 @@ thread_switch(threadstate_t newstate, struct wchan *wc, struct spinlock *lk)
 	/* Lock the run queue. */
 	spinlock_acquire(&curcpu->c_runqueue_lock);
 
+	/* Update the MLFQ level before we requeue the thread anywhere. */
+	sched_account(cur, newstate);
+
 	/* Micro-optimization: if nothing to do, just return */
 	if (newstate == S_READY && threadlist_isempty(&curcpu->c_runqueue)) {
+		cur->t_preempted = false;
 		spinlock_release(&curcpu->c_runqueue_lock);
 		splx(spl);
 		return;
@@ -603,6 +808,7 @@ thread_switch(threadstate_t newstate, struct wchan *wc, struct spinlock *lk)
 		break;
 	    case S_SLEEP:
 		cur->t_wchan_name = wc->wc_name;
+		cur->t_wchan = wc;
 		/*
 		 * Add the thread to the list in the wait channel, and
 		 * unlock same. To avoid a race with someone else
@@ -622,8 +828,9 @@ thread_switch(threadstate_t newstate, struct wchan *wc, struct spinlock *lk)
 	cur->t_state = newstate;
 
 	/*
-	 * Get the next thread. While there isn't one, call md_idle().
-	 * curcpu->c_isidle must be true when md_idle is
+	 * Get the next thread. While there isn't one, try to steal
+	 * some work from another CPU, and if that fails call
+	 * md_idle(). curcpu->c_isidle must be true when md_idle is
 	 * called. Unlock the runqueue while idling too, to make sure
 	 * things can be added to it.
 	 *
@@ -644,12 +851,36 @@ thread_switch(threadstate_t newstate, struct wchan *wc, struct spinlock *lk)
 		next = threadlist_remhead(&curcpu->c_runqueue);
 		if (next == NULL) {
 			spinlock_release(&curcpu->c_runqueue_lock);
-			cpu_idle();
+			if (!thread_steal()) {
+				/* Nothing to do; stop the clock while we wait */
+				hardclock_idle();
+				cpu_idle();
+				hardclock_resume(false);
+			}
 			spinlock_acquire(&curcpu->c_runqueue_lock);
 		}
 	} while (next == NULL);
 	curcpu->c_isidle = false;
 
+	/* Start charging the new thread for its CPU time. */
+	next->t_sched_lastrun = curcpu->c_hardclocks;
+	next->t_slice = SCHED_QUANTUM(next->t_sched_level);
+
+	/* Count the switch against whoever is giving up the cpu. */
+	if (next != cur) {
+		curcpu->c_counters[CTR_CTXSWITCH]++;
+		if (cur->t_preempted) {
+			curcpu->c_counters[CTR_PREEMPT]++;
+			cur->t_nivcsw++;
+		}
+		else {
+			cur->t_nvcsw++;
+		}
+		TRACE(TRACE_SWITCH, thread_tracepid(cur),
+		      thread_tracepid(next), newstate);
+	}
+	cur->t_preempted = false;
+
 	/*
 	 * Note that curcpu->c_curthread may be the same variable as
 	 * curthread and it may not be, depending on how curthread and
@@ -794,10 +1025,12 @@ thread_exit(void)
 	cur = curthread;
 
 	/*
-	 * Detach from our process. You might need to move this action
-	 * around, depending on how your wait/exit works.
+	 * Detach from our process, unless _exit already did so in
+	 * order to hand the process off to be destroyed.
 	 */
-	proc_remthread(cur);
+	if (cur->t_proc != NULL) {
+		proc_remthread(cur);
+	}
 
 	/* Make sure we *are* detached (move this only if you're sure!) */
 	KASSERT(cur->t_proc == NULL);
@@ -811,6 +1044,32 @@ thread_exit(void)
 	panic("braaaaaaaiiiiiiiiiiinssssss\n");
 }
 
+/*
+ * Wake up some idle cpu other than BUSY, so that it can steal work.
+ * The c_isidle checks are unlocked; at worst a cpu gets woken for
+ * nothing and goes back to sleep.
+ */
+static
+void
+thread_kick_idle(struct cpu *busy)
+{
+	struct cpu *c;
+	unsigned i, numcpus, start;
+
+	numcpus = cpuarray_num(&allcpus);
+	if (numcpus < 2) {
+		return;
+	}
+	start = busy->c_number + 1;
+	for (i = 0; i < numcpus - 1; i++) {
+		c = cpuarray_get(&allcpus, (start + i) % numcpus);
+		if (c->c_isidle) {
+			ipi_send(c, IPI_UNIDLE);
+			return;
+		}
+	}
+}
+
 /*
  * Yield the cpu to another process, but stay runnable.
  */
@@ -820,6 +1079,61 @@ thread_yield(void)
 	thread_switch(S_READY, NULL, NULL);
 }
 
+/*
+ * Timer tick for the current thread: charge it for the hardclock,
+ * and once its time slice is used up, switch to something else if
+ * there is anything else to run. A thread alone on its cpu just
+ * gets another slice, so CPU-bound work isn't switched out (and
+ * straight back in) on every tick.
+ */
+void
+thread_timeslice(void)
+{
+	struct thread *cur = curthread;
+
+	if (curcpu->c_isidle) {
+		return;
+	}
+
+	cur->t_cputime++;
+	if (cur->t_slice > 1) {
+		cur->t_slice--;
+		return;
+	}
+
+	/*
+	 * Unlocked peek; if we miss a thread that was just added, it
+	 * gets its turn at the next tick.
+	 */
+	if (threadlist_isempty(&curcpu->c_runqueue)) {
+		cur->t_slice = SCHED_QUANTUM(cur->t_sched_level);
+		return;
+	}
+
+	cur->t_preempted = true;
+	thread_switch(S_READY, NULL, NULL);
+}
+
+/*
+ * Print per-cpu context switch statistics.
+ */
+void
+thread_printstats(void)
+{
+	struct cpu *c;
+	unsigned i;
+
+	kprintf("cpu  hardclocks   switches   preempted  work batches\n");
+	for (i=0; i < cpuarray_num(&allcpus); i++) {
+		c = cpuarray_get(&allcpus, i);
+		kprintf("%3u %11u %10u %11u %5u %7u\n", c->c_number,
+			c->c_hardclocks,
+			(unsigned)counter_get(c, CTR_CTXSWITCH),
+			(unsigned)counter_get(c, CTR_PREEMPT),
+			c->c_workqueue.wq_done, c->c_workqueue.wq_batches);
+	}
+}
+
 ////////////////////////////////////////////////////////////
 
 /*
@@ -827,137 +1141,239 @@ thread_yield(void)
  *
  * This is called periodically from hardclock(). It should reshuffle
  * the current CPU's run queue by job priority.
+ *
+ * The run queue is kept sorted by MLFQ level as threads are queued
+ * (see sched_enqueue), and levels are adjusted as threads run and
+ * block (see sched_account), so all that's left for here is aging:
+ * once every SCHED_BOOST_HARDCLOCKS, move every unpinned thread on
+ * this CPU back to level 0 so CPU-bound jobs demoted to the bottom
+ * level still get to run when interactive jobs are busy.
  */
+static
+void
+sched_boost(struct thread *t)
+{
+	if (!t->t_sched_pinned) {
+		t->t_sched_level = 0;
+		t->t_sched_ticks = 0;
+	}
+}
 
 void
 schedule(void)
 {
-	/*
-	 * You can write this. If we do nothing, threads will run in
-	 * round-robin fashion.
-	 */
+	struct threadlist requeue;
+	struct thread *t;
+
+	if (curcpu->c_hardclocks - curcpu->c_sched_lastboost <
+	    SCHED_BOOST_HARDCLOCKS) {
+		return;
+	}
+	curcpu->c_sched_lastboost = curcpu->c_hardclocks;
+
+	threadlist_init(&requeue);
+	spinlock_acquire(&curcpu->c_runqueue_lock);
+
+	/* Pull everything off and refile it; pinned threads keep their level */
+	while ((t = threadlist_remhead(&curcpu->c_runqueue)) != NULL) {
+		sched_boost(t);
+		threadlist_addtail(&requeue, t);
+	}
+	while ((t = threadlist_remhead(&requeue)) != NULL) {
+		sched_enqueue(curcpu->c_self, t);
+	}
+
+	/* If we're idle, curthread is asleep and will be boosted on wakeup */
+	if (!curcpu->c_isidle) {
+		sched_boost(curthread);
+	}
+
+	spinlock_release(&curcpu->c_runqueue_lock);
+	threadlist_cleanup(&requeue);
 }
 
 /*
- * Thread migration.
- *
- * This is also called periodically from hardclock(). If the current
- * CPU is busy and other CPUs are idle, or less busy, it should move
- * threads across to those other other CPUs.
- *
- * Migrating threads isn't free because of cache affinity; a thread's
- * working cache set will end up having to be moved to the other CPU,
- * which is fairly slow. The tradeoff between this performance loss
- * and the performance loss due to underutilization of some CPUs is
- * something that needs to be tuned and probably is workload-specific.
+ * Pin a thread to MLFQ level LEVEL, or let it float again if LEVEL
+ * is SCHED_DYNAMIC. Used by setpriority().
  *
- * For here and now, because we know we're running on System/161 and
- * System/161 does not (yet) model such cache effects, we'll be very
- * aggressive.
+ * The scheduler fields belong to whichever run queue lock covers
+ * T->t_cpu, so take that, rechecking t_cpu in case the thread was
+ * stolen while we waited. If T is on the run queue, pull it off and
+ * refile it at its new level. Otherwise it is running, asleep, or in
+ * the middle of being migrated by thread_steal; leave the change
+ * pending, and sched_enqueue or sched_account applies it.
  */
 void
-thread_consider_migration(void)
+thread_set_schedclass(struct thread *t, int level)
 {
-	unsigned my_count, total_count, one_share, to_send;
-	unsigned i, numcpus;
 	struct cpu *c;
-	struct threadlist victims;
-	struct thread *t;
+	struct thread *q;
+	bool queued;
 
-	my_count = total_count = 0;
-	numcpus = cpuarray_num(&allcpus);
-	for (i=0; i<numcpus; i++) {
-		c = cpuarray_get(&allcpus, i);
+	KASSERT(level == SCHED_DYNAMIC || (level >= 0 && level < SCHED_NLEVELS));
+
+	while (1) {
+		c = t->t_cpu;
 		spinlock_acquire(&c->c_runqueue_lock);
-		total_count += c->c_runqueue.tl_count;
-		if (c == curcpu->c_self) {
-			my_count = c->c_runqueue.tl_count;
+		if (t->t_cpu == c) {
+			break;
 		}
 		spinlock_release(&c->c_runqueue_lock);
 	}
 
-	one_share = DIVROUNDUP(total_count, numcpus);
-	if (my_count < one_share) {
-		return;
+	queued = false;
+	if (t->t_state == S_READY) {
+		THREADLIST_FORALL(q, c->c_runqueue) {
+			if (q == t) {
+				queued = true;
+				break;
+			}
+		}
 	}
 
-	to_send = my_count - one_share;
-	threadlist_init(&victims);
-	spinlock_acquire(&curcpu->c_runqueue_lock);
-	for (i=0; i<to_send; i++) {
-		t = threadlist_remtail(&curcpu->c_runqueue);
-		threadlist_addhead(&victims, t);
+	if (queued) {
+		threadlist_remove(&c->c_runqueue, t);
+		sched_setclass(t, level);
+		sched_enqueue(c, t);
+	}
+	else {
+		t->t_sched_newclass = level;
+		t->t_sched_classpending = true;
 	}
-	spinlock_release(&curcpu->c_runqueue_lock);
 
-	for (i=0; i < numcpus && to_send > 0; i++) {
-		c = cpuarray_get(&allcpus, i);
+	spinlock_release(&c->c_runqueue_lock);
+}
+
+/*
+ * Thread migration.
+ *
+ * Load is balanced by work stealing: when a CPU runs out of work
+ * (in thread_switch, just before it would call cpu_idle) it pulls
+ * threads off the run queue of a busier CPU. Busy CPUs never have to
+ * look at anyone else's run queue, so nothing here runs on the timer
+ * tick path and there's no per-tick scan of every CPU.
+ *
+ * The victim is the busiest of STEAL_PROBES randomly chosen CPUs
+ * (picking the best of a couple of random choices gets most of the
+ * benefit of finding the true busiest CPU without touching them
+ * all). The queue lengths are peeked at without locking; that's only
+ * a hint, and gets rechecked once the victim's lock is held.
+ *
+ * Migrating threads isn't free because of cache affinity; a thread's
+ * working cache set will end up having to be moved to the other CPU,
+ * which is fairly slow. But stealing only happens when the thief
+ * would otherwise sit idle, and System/161 does not (yet) model such
+ * cache effects anyway, so we take half the victim's queue at a time.
+ */
+
+/*
+ * Per-cpu xorshift generator for picking victims. We don't use
+ * random() because it goes to the random device, and that's much
+ * more than we need here.
+ */
+static
+unsigned
+steal_random(void)
+{
+	unsigned x;
+
+	x = curcpu->c_steal_seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	curcpu->c_steal_seed = x;
+	return x;
+}
+
+/*
+ * Try to steal work for the current CPU. Returns true if we got any.
+ *
+ * Called from thread_switch with the current CPU marked idle and its
+ * run queue unlocked; we never hold two run queue locks at once.
+ */
+static
+bool
+thread_steal(void)
+{
+	unsigned numcpus, i, count, best_count, to_take;
+	struct cpu *c, *victim;
+	struct threadlist stolen, keep;
+	struct thread *t;
+
+	numcpus = cpuarray_num(&allcpus);
+	if (numcpus < 2) {
+		return false;
+	}
+
+	victim = NULL;
+	best_count = 0;
+	for (i=0; i<STEAL_PROBES; i++) {
+		c = cpuarray_get(&allcpus, steal_random() % numcpus);
 		if (c == curcpu->c_self) {
 			continue;
 		}
-		spinlock_acquire(&c->c_runqueue_lock);
-		while (c->c_runqueue.tl_count < one_share && to_send > 0) {
-			t = threadlist_remhead(&victims);
-			/*
-			 * Ordinarily, curthread will not appear on
-			 * the run queue. However, it can under the
-			 * following circumstances:
-			 *   - it went to sleep;
-			 *   - the processor became idle, so it
-			 *     remained curthread;
-			 *   - it was reawakened, so it was put on the
-			 *     run queue;
-			 *   - and the processor hasn't fully unidled
-			 *     yet, so all these things are still true.
-			 *
-			 * If the timer interrupt happens at (almost)
-			 * exactly the proper moment, we can come here
-			 * while things are in this state and see
-			 * curthread. However, *migrating* curthread
-			 * can cause bad things to happen (Exercise:
-			 * Why? And what?) so shuffle it to the end of
-			 * the list and decrement to_send in order to
-			 * skip it. Then it goes back on our own run
-			 * queue below.
-			 */
-			if (t == curthread) {
-				threadlist_addtail(&victims, t);
-				to_send--;
-				continue;
-			}
-
-			t->t_cpu = c;
-			threadlist_addtail(&c->c_runqueue, t);
-			DEBUG(DB_THREADS,
-			      "Migrated thread %s: cpu %u -> %u",
-			      t->t_name, curcpu->c_number, c->c_number);
-			to_send--;
-			if (c->c_isidle) {
-				/*
-				 * Other processor is idle; send
-				 * interrupt to make sure it unidles.
-				 */
-				ipi_send(c, IPI_UNIDLE);
-			}
+		/* Unlocked peek; this is only a hint. */
+		count = c->c_runqueue.tl_count;
+		if (count > best_count) {
+			victim = c;
+			best_count = count;
 		}
-		spinlock_release(&c->c_runqueue_lock);
 	}
+	if (victim == NULL) {
+		return false;
+	}
+
+	threadlist_init(&stolen);
+	threadlist_init(&keep);
 
+	spinlock_acquire(&victim->c_runqueue_lock);
 	/*
-	 * Because the code above isn't atomic, the thread counts may have
-	 * changed while we were working and we may end up with leftovers.
-	 * Don't panic; just put them back on our own run queue.
+	 * Leave idle CPUs alone: they're about to run what's on their
+	 * queue, and the thread on it may be the CPU's own curthread,
+	 * which has just been woken but not yet switched back to.
+	 * Migrating that would be bad. (While a CPU is not idle, its
+	 * curthread is never on a run queue visible to us, because
+	 * thread_switch holds the run queue lock across the switch.)
+	 *
+	 * Take from the tail, where the least urgent threads are,
+	 * stepping over (and afterwards putting back) bound threads.
 	 */
-	if (!threadlist_isempty(&victims)) {
-		spinlock_acquire(&curcpu->c_runqueue_lock);
-		while ((t = threadlist_remhead(&victims)) != NULL) {
-			threadlist_addtail(&curcpu->c_runqueue, t);
+	if (!victim->c_isidle) {
+		to_take = DIVROUNDUP(victim->c_runqueue.tl_count, 2);
+		i = 0;
+		while (i < to_take &&
+		       (t = threadlist_remtail(&victim->c_runqueue)) != NULL) {
+			KASSERT(t != victim->c_curthread);
+			if (t->t_bound) {
+				threadlist_addhead(&keep, t);
+				continue;
+			}
+			t->t_cpu = curcpu->c_self;
+			threadlist_addhead(&stolen, t);
+			i++;
+		}
+		while ((t = threadlist_remhead(&keep)) != NULL) {
+			threadlist_addtail(&victim->c_runqueue, t);
 		}
-		spinlock_release(&curcpu->c_runqueue_lock);
 	}
+	spinlock_release(&victim->c_runqueue_lock);
+	threadlist_cleanup(&keep);
 
-	KASSERT(threadlist_isempty(&victims));
-	threadlist_cleanup(&victims);
+	if (threadlist_isempty(&stolen)) {
+		threadlist_cleanup(&stolen);
+		return false;
+	}
+
+	spinlock_acquire(&curcpu->c_runqueue_lock);
+	while ((t = threadlist_remhead(&stolen)) != NULL) {
+		DEBUG(DB_THREADS, "Stole thread %s: cpu %u -> %u",
+		      t->t_name, victim->c_number, curcpu->c_number);
+		sched_enqueue(curcpu->c_self, t);
+	}
+	spinlock_release(&curcpu->c_runqueue_lock);
+
+	threadlist_cleanup(&stolen);
+	return true;
 }
 
 ////////////////////////////////////////////////////////////
@@ -1051,6 +1467,79 @@ wchan_sleep(struct wchan *wc, struct spinlock *lk)
 	spinlock_acquire(lk);
 }
 
+/*
+ * State shared between wchan_sleep_timeout and its timer. Lives on
+ * the sleeper's stack; timer_cancel makes sure the timer is done with
+ * it before the sleeper returns.
+ */
+struct wchan_timeout {
+	struct thread *wt_thread;
+	struct wchan *wt_wchan;
+	struct spinlock *wt_lock;
+	bool wt_fired;
+};
+
+/*
+ * Timer function for wchan_sleep_timeout. If the thread is still on
+ * the channel, nobody has woken it yet; take it off and wake it.
+ */
+static
+void
+wchan_timeout_fire(void *arg)
+{
+	struct wchan_timeout *wt = arg;
+	struct thread *target = wt->wt_thread;
+
+	spinlock_acquire(wt->wt_lock);
+	if (target->t_wchan == wt->wt_wchan) {
+		threadlist_remove(&wt->wt_wchan->wc_threads, target);
+		target->t_wchan = NULL;
+		wt->wt_fired = true;
+		thread_make_runnable(target, false);
+	}
+	spinlock_release(wt->wt_lock);
+}
+
+/*
+ * Like wchan_sleep, but give up after TICKS hardclocks. Returns 0 if
+ * woken by wchan_wake*, or ETIMEDOUT.
+ */
+int
+wchan_sleep_timeout(struct wchan *wc, struct spinlock *lk, unsigned ticks)
+{
+	struct wchan_timeout wt;
+	struct timer tm;
+
+	/* may not sleep in an interrupt handler */
+	KASSERT(!curthread->t_in_interrupt);
+
+	/* must hold the spinlock */
+	KASSERT(spinlock_do_i_hold(lk));
+
+	/* must not hold other spinlocks */
+	KASSERT(curcpu->c_spinlocks == 1);
+
+	wt.wt_thread = curthread;
+	wt.wt_wchan = wc;
+	wt.wt_lock = lk;
+	wt.wt_fired = false;
+
+	/*
+	 * Arm the timer while still holding LK. It can't get at us
+	 * until thread_switch has put us on the channel and let go.
+	 */
+	timer_init(&tm, wchan_timeout_fire, &wt);
+	timer_add(&tm, ticks);
+
+	thread_switch(S_SLEEP, wc, lk);
+
+	/* Without LK, since the timer function may be waiting for it. */
+	timer_cancel(&tm);
+	spinlock_acquire(lk);
+
+	return wt.wt_fired ? ETIMEDOUT : 0;
+}
+
 /*
  * Wake up one thread sleeping on a wait channel.
  */
@@ -1068,6 +1557,7 @@ wchan_wakeone(struct wchan *wc, struct spinlock *lk)
 		/* Nobody was sleeping. */
 		return;
 	}
+	target->t_wchan = NULL;
 
 	/*
 	 * Note that thread_make_runnable acquires a runqueue lock
@@ -1098,6 +1588,7 @@ wchan_wakeall(struct wchan *wc, struct spinlock *lk)
 	 * private list.
 	 */
 	while ((target = threadlist_remhead(&wc->wc_threads)) != NULL) {
+		target->t_wchan = NULL;
 		threadlist_addtail(&list, target);
 	}
 
@@ -1113,6 +1604,25 @@ wchan_wakeall(struct wchan *wc, struct spinlock *lk)
 	threadlist_cleanup(&list);
 }
 
+/*
+ * Wake up one particular thread, if it is sleeping on the channel.
+ */
+bool
+wchan_wakethread(struct wchan *wc, struct thread *target,
+		 struct spinlock *lk)
+{
+	KASSERT(spinlock_do_i_hold(lk));
+
+	if (target->t_wchan != wc) {
+		/* Already woken, e.g. by a timeout. */
+		return false;
+	}
+	threadlist_remove(&wc->wc_threads, target);
+	target->t_wchan = NULL;
+	thread_make_runnable(target, false);
+	return true;
+}
+
 /*
  * Return nonzero if there are no threads sleeping on the channel.
  * This is meant to be used only for diagnostic purposes.
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Kernel timers: per-CPU hierarchical timer wheels. See timer.h.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <spl.h>
+#include <cpu.h>
+#include <current.h>
+#include <clock.h>
+#include <timer.h>
+
+#define TIMERWHEEL_MASK    (TIMERWHEEL_SLOTS - 1)
+
+/* Ticks covered by the whole wheel; anything further out is parked. */
+#define TIMERWHEEL_SPAN    ((uint64_t)1 << (TIMERWHEEL_BITS * TIMERWHEEL_LEVELS))
+
+/*
+ * List operations. Slots are singly linked lists with back pointers
+ * (tm_pprev points at whatever points at us), so any timer can be
+ * unlinked without knowing which slot it is in.
+ */
+static
+void
+timer_link(struct timer **head, struct timer *tm)
+{
+	tm->tm_next = *head;
+	if (tm->tm_next != NULL) {
+		tm->tm_next->tm_pprev = &tm->tm_next;
+	}
+	tm->tm_pprev = head;
+	*head = tm;
+}
+
+static
+void
+timer_unlink(struct timer *tm)
+{
+	*tm->tm_pprev = tm->tm_next;
+	if (tm->tm_next != NULL) {
+		tm->tm_next->tm_pprev = tm->tm_pprev;
+	}
+	tm->tm_next = NULL;
+	tm->tm_pprev = NULL;
+}
+
+/*
+ * Put a timer in the right slot for its expiry time. Timers due
+ * within TIMERWHEEL_SLOTS ticks go on level 0, indexed by the low
+ * bits of the expiry time; the next TIMERWHEEL_BITS bits pick the
+ * slot on level 1, and so on. The caller holds the wheel lock.
+ */
+static
+void
+timerwheel_place(struct timerwheel *tw, struct timer *tm)
+{
+	uint64_t expires, delta;
+	unsigned level, slot;
+
+	expires = tm->tm_expires;
+	if (expires < tw->tw_now) {
+		expires = tw->tw_now;
+	}
+	delta = expires - tw->tw_now;
+	if (delta >= TIMERWHEEL_SPAN) {
+		/* Park it; it gets placed again when this slot cascades. */
+		expires = tw->tw_now + TIMERWHEEL_SPAN - 1;
+		delta = TIMERWHEEL_SPAN - 1;
+	}
+
+	level = 0;
+	while (delta >= ((uint64_t)1 << (TIMERWHEEL_BITS * (level + 1)))) {
+		level++;
+	}
+	KASSERT(level < TIMERWHEEL_LEVELS);
+
+	slot = (expires >> (TIMERWHEEL_BITS * level)) & TIMERWHEEL_MASK;
+	timer_link(&tw->tw_slots[level][slot], tm);
+}
+
+////////////////////////////////////////////////////////////
+// Timers
+
+void
+timer_init(struct timer *tm, void (*func)(void *), void *arg)
+{
+	tm->tm_next = NULL;
+	tm->tm_pprev = NULL;
+	tm->tm_expires = 0;
+	tm->tm_wheel = NULL;
+	tm->tm_pending = false;
+	tm->tm_func = func;
+	tm->tm_arg = arg;
+}
+
+void
+timer_add(struct timer *tm, unsigned ticks)
+{
+	struct timerwheel *tw;
+	int s;
+
+	KASSERT(tm->tm_func != NULL);
+	KASSERT(!tm->tm_pending);
+
+	if (ticks == 0) {
+		ticks = 1;
+	}
+
+	/* Keep us from being moved to another cpu while we look at curcpu. */
+	s = splhigh();
+	tw = &curcpu->c_self->c_timerwheel;
+
+	spinlock_acquire(&tw->tw_lock);
+	tm->tm_wheel = tw;
+	tm->tm_expires = tw->tw_now + ticks;
+	tm->tm_pending = true;
+	timerwheel_place(tw, tm);
+	tw->tw_count++;
+	spinlock_release(&tw->tw_lock);
+
+	splx(s);
+}
+
+bool
+timer_cancel(struct timer *tm)
+{
+	struct timerwheel *tw;
+
+	tw = tm->tm_wheel;
+	if (tw == NULL) {
+		/* Never armed */
+		return false;
+	}
+
+	spinlock_acquire(&tw->tw_lock);
+	if (tm->tm_pending) {
+		timer_unlink(tm);
+		tm->tm_pending = false;
+		tw->tw_count--;
+		spinlock_release(&tw->tw_lock);
+		return true;
+	}
+
+	/*
+	 * Already fired. If the function is still running (on the
+	 * wheel's cpu, so not on ours) wait for it, so the caller can
+	 * free whatever it uses.
+	 */
+	while (tw->tw_running == tm) {
+		spinlock_release(&tw->tw_lock);
+		spinlock_acquire(&tw->tw_lock);
+	}
+	spinlock_release(&tw->tw_lock);
+	return false;
+}
+
+/*
+ * Convert a time interval to hardclocks, rounding up.
+ */
+unsigned
+timer_hardclocks(const struct timespec *ts)
+{
+	const uint64_t nsecs_per_tick = 1000000000 / HZ;
+	uint64_t nsecs, ticks;
+
+	nsecs = (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+	ticks = (nsecs + nsecs_per_tick - 1) / nsecs_per_tick;
+	if (ticks > 0xffffffff) {
+		ticks = 0xffffffff;
+	}
+	return ticks;
+}
+
+////////////////////////////////////////////////////////////
+// Wheels
+
+void
+timerwheel_init(struct timerwheel *tw)
+{
+	unsigned level, slot;
+
+	spinlock_init(&tw->tw_lock);
+	tw->tw_now = 0;
+	for (level = 0; level < TIMERWHEEL_LEVELS; level++) {
+		for (slot = 0; slot < TIMERWHEEL_SLOTS; slot++) {
+			tw->tw_slots[level][slot] = NULL;
+		}
+	}
+	tw->tw_expired = NULL;
+	tw->tw_running = NULL;
+	tw->tw_count = 0;
+}
+
+/*
+ * Move the wheel on by one tick and run whatever comes due. Called
+ * with the wheel lock held; drops it while running timer functions.
+ */
+static
+void
+timerwheel_step(struct timerwheel *tw)
+{
+	struct timer *tm, *next;
+	unsigned level, slot;
+
+	KASSERT(spinlock_do_i_hold(&tw->tw_lock));
+
+	tw->tw_now++;
+
+	/*
+	 * Each time a wheel wraps around, spread the next slot of the
+	 * wheel above it out onto the lower levels.
+	 */
+	for (level = 1; level < TIMERWHEEL_LEVELS; level++) {
+		if (((tw->tw_now >> (TIMERWHEEL_BITS * (level - 1)))
+		     & TIMERWHEEL_MASK) != 0) {
+			break;
+		}
+		slot = (tw->tw_now >> (TIMERWHEEL_BITS * level))
+			& TIMERWHEEL_MASK;
+		tm = tw->tw_slots[level][slot];
+		tw->tw_slots[level][slot] = NULL;
+		while (tm != NULL) {
+			next = tm->tm_next;
+			timerwheel_place(tw, tm);
+			tm = next;
+		}
+	}
+
+	/* Everything in the current level 0 slot is due now. */
+	slot = tw->tw_now & TIMERWHEEL_MASK;
+	KASSERT(tw->tw_expired == NULL);
+	tw->tw_expired = tw->tw_slots[0][slot];
+	tw->tw_slots[0][slot] = NULL;
+	if (tw->tw_expired != NULL) {
+		tw->tw_expired->tm_pprev = &tw->tw_expired;
+	}
+
+	/*
+	 * Run them one at a time without the lock, so they can be
+	 * cancelled up to the moment they start.
+	 */
+	while ((tm = tw->tw_expired) != NULL) {
+		KASSERT(tm->tm_expires <= tw->tw_now);
+		timer_unlink(tm);
+		tm->tm_pending = false;
+		tw->tw_count--;
+		tw->tw_running = tm;
+		spinlock_release(&tw->tw_lock);
+
+		tm->tm_func(tm->tm_arg);
+
+		spinlock_acquire(&tw->tw_lock);
+		tw->tw_running = NULL;
+	}
+}
+
+/*
+ * Advance the current cpu's wheel by one tick. Called from hardclock.
+ */
+void
+timerwheel_tick(void)
+{
+	timerwheel_advance(1);
+}
+
+/*
+ * Advance the current cpu's wheel by TICKS ticks at once, running
+ * everything that comes due on the way, in order. Used when a cpu
+ * comes back from sleeping through its hardclocks.
+ */
+void
+timerwheel_advance(unsigned ticks)
+{
+	struct timerwheel *tw;
+
+	tw = &curcpu->c_self->c_timerwheel;
+
+	/*
+	 * Only this cpu adds timers to its wheel, and we're in an
+	 * interrupt handler (or have interrupts off), so if it's empty
+	 * nothing can show up until we're done. Skip the lock.
+	 */
+	if (tw->tw_count == 0) {
+		tw->tw_now += ticks;
+		return;
+	}
+
+	spinlock_acquire(&tw->tw_lock);
+	while (ticks > 0) {
+		if (tw->tw_count == 0) {
+			/* Nothing left to cascade or fire; jump ahead. */
+			tw->tw_now += ticks;
+			break;
+		}
+		timerwheel_step(tw);
+		ticks--;
+	}
+	spinlock_release(&tw->tw_lock);
+}
+
+/*
+ * How many ticks the current cpu can go without advancing its wheel:
+ * the distance to the first slot, on any level, that has anything in
+ * it, which is no later than the earliest timer. A higher level's slot
+ * can come due (and cascade) before a lower level's, so every level
+ * has to be looked at. Returns 0 if there are no timers.
+ */
+unsigned
+timerwheel_idle_ticks(void)
+{
+	struct timerwheel *tw;
+	uint64_t base, dist, ret;
+	unsigned level, i, shift;
+
+	tw = &curcpu->c_self->c_timerwheel;
+	if (tw->tw_count == 0) {
+		return 0;
+	}
+
+	ret = 0;
+	spinlock_acquire(&tw->tw_lock);
+	for (level = 0; level < TIMERWHEEL_LEVELS; level++) {
+		shift = TIMERWHEEL_BITS * level;
+		base = tw->tw_now >> shift;
+		for (i = 1; i <= TIMERWHEEL_SLOTS; i++) {
+			if (tw->tw_slots[level][(base + i) & TIMERWHEEL_MASK]
+			    != NULL) {
+				/* That slot is reached (or cascaded) here */
+				dist = ((base + i) << shift) - tw->tw_now;
+				if (ret == 0 || dist < ret) {
+					ret = dist;
+				}
+				break;
+			}
+		}
+	}
+	spinlock_release(&tw->tw_lock);
+
+	/* ret is still 0 if the last timer was cancelled meanwhile */
+	if (ret > 0xffffffff) {
+		ret = 0xffffffff;
+	}
+	return ret;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Kernel event tracing. See trace.h.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/fcntl.h>
+#include <lib.h>
+#include <spl.h>
+#include <membar.h>
+#include <cpu.h>
+#include <current.h>
+#include <clock.h>
+#include <uio.h>
+#include <vfs.h>
+#include <vnode.h>
+#include <trace.h>
+
+volatile bool trace_enabled;
+
+void
+trace_record(unsigned type, uint32_t a0, uint32_t a1, uint32_t a2)
+{
+	struct trace_ring *r;
+	struct trace_event *te;
+	struct timespec ts;
+	int s;
+
+	/* Interrupts off, so nothing else on this cpu gets in the way. */
+	s = splhigh();
+	r = curcpu->c_tracering;
+	if (trace_enabled && r != NULL) {
+		gettime(&ts);
+		te = &r->tr_events[r->tr_total % TRACE_RINGSIZE];
+		te->te_sec = ts.tv_sec;
+		te->te_nsec = ts.tv_nsec;
+		te->te_type = type;
+		te->te_cpu = curcpu->c_number;
+		te->te_arg[0] = a0;
+		te->te_arg[1] = a1;
+		te->te_arg[2] = a2;
+		r->tr_total++;
+	}
+	splx(s);
+}
+
+int
+trace_start(void)
+{
+	struct trace_ring *r;
+	struct cpu *c;
+	unsigned i;
+
+	trace_enabled = false;
+	membar_any_any();
+
+	/* As with the profiler, rings are never freed once allocated. */
+	for (i=0; i<cpu_count(); i++) {
+		c = cpu_get(i);
+		if (c->c_tracering == NULL) {
+			r = kmalloc(sizeof(*r));
+			if (r == NULL) {
+				return ENOMEM;
+			}
+			c->c_tracering = r;
+		}
+		c->c_tracering->tr_total = 0;
+	}
+
+	membar_any_any();
+	trace_enabled = true;
+	return 0;
+}
+
+void
+trace_stop(void)
+{
+	trace_enabled = false;
+	membar_any_any();
+}
+
+static
+int
+trace_write(struct vnode *vn, off_t *pos, void *buf, size_t len)
+{
+	struct iovec iov;
+	struct uio ku;
+	int result;
+
+	uio_kinit(&iov, &ku, buf, len, *pos, UIO_WRITE);
+	result = VOP_WRITE(vn, &ku);
+	if (result) {
+		return result;
+	}
+	*pos = ku.uio_offset;
+	return 0;
+}
+
+/*
+ * Write out each cpu's ring, oldest event first. Tracing is stopped
+ * first; otherwise events would be changing under us.
+ */
+int
+trace_save(const char *path)
+{
+	struct trace_filehdr hdr;
+	struct trace_ring *r;
+	struct vnode *vn;
+	char *pathbuf;
+	unsigned i, total, have, start, first;
+	off_t pos;
+	int result;
+
+	trace_stop();
+
+	hdr.th_magic = TRACE_MAGIC;
+	hdr.th_ncpus = cpu_count();
+	hdr.th_nevents = 0;
+	hdr.th_lost = 0;
+	for (i=0; i<cpu_count(); i++) {
+		r = cpu_get(i)->c_tracering;
+		if (r == NULL) {
+			continue;
+		}
+		have = r->tr_total < TRACE_RINGSIZE ?
+			r->tr_total : TRACE_RINGSIZE;
+		hdr.th_nevents += have;
+		hdr.th_lost += r->tr_total - have;
+	}
+
+	pathbuf = kstrdup(path);
+	if (pathbuf == NULL) {
+		return ENOMEM;
+	}
+	result = vfs_open(pathbuf, O_WRONLY|O_CREAT|O_TRUNC, 0664, &vn);
+	kfree(pathbuf);
+	if (result) {
+		return result;
+	}
+
+	pos = 0;
+	result = trace_write(vn, &pos, &hdr, sizeof(hdr));
+	for (i=0; i<cpu_count() && result == 0; i++) {
+		r = cpu_get(i)->c_tracering;
+		if (r == NULL) {
+			continue;
+		}
+		total = r->tr_total;
+		have = total < TRACE_RINGSIZE ? total : TRACE_RINGSIZE;
+		if (have == 0) {
+			continue;
+		}
+		/*
+		 * The oldest event is at START; if the ring has wrapped,
+		 * that's in the middle and it takes two writes.
+		 */
+		start = (total - have) % TRACE_RINGSIZE;
+		first = have < TRACE_RINGSIZE - start ?
+			have : TRACE_RINGSIZE - start;
+		result = trace_write(vn, &pos, &r->tr_events[start],
+				     first * sizeof(struct trace_event));
+		if (result == 0 && first < have) {
+			result = trace_write(vn, &pos, &r->tr_events[0],
+				(have - first) * sizeof(struct trace_event));
+		}
+	}
+
+	vfs_close(vn);
+	if (result == 0) {
+		kprintf("trace: wrote %u events (%u lost) to %s\n",
+			hdr.th_nevents, hdr.th_lost, path);
+	}
+	return result;
+}
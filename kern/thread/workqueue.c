@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Deferred work queues. See workqueue.h.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <cpu.h>
+#include <spinlock.h>
+#include <wchan.h>
+#include <thread.h>
+#include <current.h>
+#include <workqueue.h>
+
+/*
+ * Set up a cpu's queue. Work enqueued before the worker exists is
+ * run on the spot.
+ */
+void
+workqueue_init(struct workqueue *wq)
+{
+	spinlock_init(&wq->wq_lock);
+	wq->wq_wchan = NULL;
+	wq->wq_head = NULL;
+	wq->wq_tailp = &wq->wq_head;
+	wq->wq_pending = 0;
+	wq->wq_batches = 0;
+	wq->wq_done = 0;
+}
+
+/*
+ * The worker: sleep until there's work, take all of it, run it.
+ */
+static
+void
+workqueue_worker(void *data1, unsigned long data2)
+{
+	struct workqueue *wq = data1;
+	struct workitem *batch, *wi;
+	unsigned n;
+
+	(void)data2;
+
+	spinlock_acquire(&wq->wq_lock);
+	while (1) {
+		while (wq->wq_head == NULL) {
+			wchan_sleep(wq->wq_wchan, &wq->wq_lock);
+		}
+		batch = wq->wq_head;
+		n = wq->wq_pending;
+		wq->wq_head = NULL;
+		wq->wq_tailp = &wq->wq_head;
+		wq->wq_pending = 0;
+		spinlock_release(&wq->wq_lock);
+
+		while (batch != NULL) {
+			wi = batch;
+			batch = wi->wi_next;
+			wi->wi_func(wi->wi_arg);
+			kfree(wi);
+		}
+
+		spinlock_acquire(&wq->wq_lock);
+		wq->wq_batches++;
+		wq->wq_done += n;
+	}
+}
+
+void
+workqueue_start(struct cpu *c)
+{
+	struct workqueue *wq = &c->c_workqueue;
+	struct wchan *wc;
+	char name[16];
+	int result;
+
+	wc = wchan_create("workqueue");
+	if (wc == NULL) {
+		panic("workqueue_start: out of memory\n");
+	}
+	spinlock_acquire(&wq->wq_lock);
+	wq->wq_wchan = wc;
+	spinlock_release(&wq->wq_lock);
+
+	snprintf(name, sizeof(name), "worker/%u", c->c_number);
+	result = thread_fork_bound(c, name, NULL, workqueue_worker, wq, 0);
+	if (result) {
+		panic("workqueue_start: thread_fork_bound failed: %s\n",
+		      strerror(result));
+	}
+}
+
+void
+workqueue_enqueue(void (*func)(void *), void *arg)
+{
+	struct workqueue *wq;
+	struct workitem *wi;
+	bool wasempty;
+
+	/*
+	 * If we move to another cpu after looking at curcpu, the work
+	 * just runs on the old one; that's fine.
+	 */
+	wq = &curcpu->c_workqueue;
+	if (wq->wq_wchan == NULL) {
+		func(arg);
+		return;
+	}
+
+	wi = kmalloc(sizeof(*wi));
+	if (wi == NULL) {
+		func(arg);
+		return;
+	}
+	wi->wi_next = NULL;
+	wi->wi_func = func;
+	wi->wi_arg = arg;
+
+	spinlock_acquire(&wq->wq_lock);
+	wasempty = wq->wq_head == NULL;
+	*wq->wq_tailp = wi;
+	wq->wq_tailp = &wi->wi_next;
+	wq->wq_pending++;
+	if (wasempty) {
+		wchan_wakeone(wq->wq_wchan, &wq->wq_lock);
+	}
+	spinlock_release(&wq->wq_lock);
+}
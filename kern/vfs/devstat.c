@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * The statistics device, "stat:". Reading it gives the current totals
+ * of the kernel's event counters (see counters.h) as text, one
+ * "name value" line per counter. It can't be written.
+ *
+ * The text is regenerated for every read, so a read at offset N sees
+ * current values. Lines are fixed-width, so reading in pieces (as
+ * cat does) still lines up.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <uio.h>
+#include <vfs.h>
+#include <device.h>
+#include <counters.h>
+
+/* For open() */
+static
+int
+statopen(struct device *dev, int openflags)
+{
+	(void)dev;
+	(void)openflags;
+
+	return 0;
+}
+
+/* For d_io() */
+static
+int
+statio(struct device *dev, struct uio *uio)
+{
+	const size_t bufsize = NCOUNTERS * COUNTERS_LINELEN;
+	char *buf;
+	size_t len;
+	int result;
+
+	(void)dev;
+
+	if (uio->uio_rw == UIO_WRITE) {
+		return EROFS;
+	}
+
+	buf = kmalloc(bufsize);
+	if (buf == NULL) {
+		return ENOMEM;
+	}
+	len = counters_format(buf, bufsize);
+
+	if (uio->uio_offset < 0) {
+		result = EINVAL;
+	}
+	else if ((uint64_t)uio->uio_offset >= len) {
+		/* EOF */
+		result = 0;
+	}
+	else {
+		result = uiomove(buf + uio->uio_offset,
+				 len - uio->uio_offset, uio);
+	}
+
+	kfree(buf);
+	return result;
+}
+
+/* For ioctl() */
+static
+int
+statioctl(struct device *dev, int op, userptr_t data)
+{
+	(void)dev;
+	(void)op;
+	(void)data;
+
+	return EINVAL;
+}
+
+static const struct device_ops stat_devops = {
+	.devop_eachopen = statopen,
+	.devop_io = statio,
+	.devop_ioctl = statioctl,
+};
+
+/*
+ * Function to create and attach stat:
+ */
+void
+devstat_create(void)
+{
+	int result;
+	struct device *dev;
+
+	dev = kmalloc(sizeof(*dev));
+	if (dev==NULL) {
+		panic("Could not add stat device: out of memory\n");
+	}
+
+	dev->d_ops = &stat_devops;
+
+	dev->d_blocks = 0;
+	dev->d_blocksize = 1;
+
+	dev->d_devnumber = 0; /* assigned by vfs_adddev */
+
+	dev->d_data = NULL;
+
+	result = vfs_adddev("stat", dev, 0);
+	if (result) {
+		panic("Could not add stat device: %s\n", strerror(result));
+	}
+}
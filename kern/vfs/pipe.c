@@ -0,0 +1,517 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Anonymous pipes. See pipe.h.
+ *
+ * Only one reader and one writer touch the ring at a time: readers
+ * are serialized by p_readlock and writers by p_writelock. (Holding
+ * p_writelock across a whole write also keeps writes from different
+ * writers from interleaving.) With a single producer and a single
+ * consumer the ring needs no lock of its own. The writer owns p_head,
+ * the reader owns p_tail, and each only reads the other's index. Both
+ * indexes count bytes ever moved and wrap naturally, so head - tail is
+ * the amount buffered.
+ *
+ * The spinlock and wchans are used only to go to sleep and wake up.
+ * A side about to sleep sets its p_*sleeping flag, then rechecks the
+ * other index; a side that moves its index then checks the flag. With
+ * a full barrier between the store and the load in both, at least one
+ * of them sees the other's store, so no wakeup is lost. When nobody is
+ * sleeping the spinlock is never touched.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <stat.h>
+#include <lib.h>
+#include <uio.h>
+#include <spinlock.h>
+#include <wchan.h>
+#include <synch.h>
+#include <membar.h>
+#include <vnode.h>
+#include <pipe.h>
+
+/* Size of the ring buffer. Must be a power of 2 so the indexes can wrap. */
+#define PIPE_SIZE 4096
+
+struct pipe {
+	struct vnode p_readvn;		/* read end */
+	struct vnode p_writevn;		/* write end */
+
+	char *p_buf;			/* the ring buffer */
+	volatile unsigned p_head;	/* bytes ever written; writer's */
+	volatile unsigned p_tail;	/* bytes ever read; reader's */
+
+	struct lock *p_readlock;	/* one reader at a time */
+	struct lock *p_writelock;	/* one writer at a time */
+
+	struct spinlock p_lock;		/* for sleeping/waking and closing */
+	struct wchan *p_readwchan;	/* reader waits here for data */
+	struct wchan *p_writewchan;	/* writer waits here for space */
+	volatile bool p_readsleeping;
+	volatile bool p_writesleeping;
+	volatile bool p_readclosed;	/* read end reclaimed */
+	volatile bool p_writeclosed;	/* write end reclaimed */
+};
+
+static const struct vnode_ops pipe_vnode_ops;
+
+/*
+ * Destructor. Both ends must already be gone.
+ */
+static
+void
+pipe_destroy(struct pipe *p)
+{
+	KASSERT(p->p_readclosed && p->p_writeclosed);
+
+	wchan_destroy(p->p_writewchan);
+	wchan_destroy(p->p_readwchan);
+	spinlock_cleanup(&p->p_lock);
+	lock_destroy(p->p_writelock);
+	lock_destroy(p->p_readlock);
+	kfree(p->p_buf);
+	kfree(p);
+}
+
+/*
+ * Constructor.
+ */
+int
+pipe_create(struct vnode **readvn, struct vnode **writevn)
+{
+	struct pipe *p;
+
+	p = kmalloc(sizeof(*p));
+	if (p == NULL) {
+		return ENOMEM;
+	}
+	p->p_buf = kmalloc(PIPE_SIZE);
+	if (p->p_buf == NULL) {
+		goto fail_pipe;
+	}
+	p->p_readlock = lock_create("pipe read");
+	if (p->p_readlock == NULL) {
+		goto fail_buf;
+	}
+	p->p_writelock = lock_create("pipe write");
+	if (p->p_writelock == NULL) {
+		goto fail_readlock;
+	}
+	p->p_readwchan = wchan_create("pipe read");
+	if (p->p_readwchan == NULL) {
+		goto fail_writelock;
+	}
+	p->p_writewchan = wchan_create("pipe write");
+	if (p->p_writewchan == NULL) {
+		goto fail_readwchan;
+	}
+	spinlock_init(&p->p_lock);
+
+	p->p_head = 0;
+	p->p_tail = 0;
+	p->p_readsleeping = false;
+	p->p_writesleeping = false;
+	p->p_readclosed = false;
+	p->p_writeclosed = false;
+
+	vnode_init(&p->p_readvn, &pipe_vnode_ops, NULL, p);
+	vnode_init(&p->p_writevn, &pipe_vnode_ops, NULL, p);
+
+	*readvn = &p->p_readvn;
+	*writevn = &p->p_writevn;
+	return 0;
+
+ fail_readwchan:
+	wchan_destroy(p->p_readwchan);
+ fail_writelock:
+	lock_destroy(p->p_writelock);
+ fail_readlock:
+	lock_destroy(p->p_readlock);
+ fail_buf:
+	kfree(p->p_buf);
+ fail_pipe:
+	kfree(p);
+	return ENOMEM;
+}
+
+/*
+ * Wake the other side if it's asleep. Called after moving our index.
+ */
+static
+void
+pipe_wake(struct pipe *p, volatile bool *sleeping, struct wchan *wc)
+{
+	/* Order our index store before reading the flag; see above. */
+	membar_any_any();
+	if (*sleeping) {
+		spinlock_acquire(&p->p_lock);
+		wchan_wakeall(wc, &p->p_lock);
+		spinlock_release(&p->p_lock);
+	}
+}
+
+/*
+ * Reader: wait until there's data past TAIL or the write end is gone.
+ * Returns the head index seen; if it equals TAIL, that's EOF.
+ */
+static
+unsigned
+pipe_waitdata(struct pipe *p, unsigned tail)
+{
+	unsigned head;
+
+	/* Fast path: there's data already. */
+	head = p->p_head;
+	if (head != tail) {
+		return head;
+	}
+
+	spinlock_acquire(&p->p_lock);
+	while (1) {
+		p->p_readsleeping = true;
+		membar_any_any();
+		head = p->p_head;
+		if (head != tail || p->p_writeclosed) {
+			break;
+		}
+		wchan_sleep(p->p_readwchan, &p->p_lock);
+	}
+	p->p_readsleeping = false;
+	spinlock_release(&p->p_lock);
+	return head;
+}
+
+/*
+ * Writer: wait until there's space after HEAD. Returns the tail index
+ * seen in *TAIL, or EPIPE if the read end is gone.
+ */
+static
+int
+pipe_waitspace(struct pipe *p, unsigned head, unsigned *tail)
+{
+	int result = 0;
+
+	/* Fast path: there's room already. */
+	if (p->p_readclosed) {
+		return EPIPE;
+	}
+	*tail = p->p_tail;
+	if (head - *tail < PIPE_SIZE) {
+		return 0;
+	}
+
+	spinlock_acquire(&p->p_lock);
+	while (1) {
+		p->p_writesleeping = true;
+		membar_any_any();
+		*tail = p->p_tail;
+		if (p->p_readclosed) {
+			result = EPIPE;
+			break;
+		}
+		if (head - *tail < PIPE_SIZE) {
+			break;
+		}
+		wchan_sleep(p->p_writewchan, &p->p_lock);
+	}
+	p->p_writesleeping = false;
+	spinlock_release(&p->p_lock);
+	return result;
+}
+
+/*
+ * Called for each open(). Pipes have no names, so this is only reached
+ * by way of pipe(); nothing to do.
+ */
+static
+int
+pipe_eachopen(struct vnode *v, int flags)
+{
+	(void)v;
+	(void)flags;
+	return 0;
+}
+
+/*
+ * Called when the last reference to one end goes away. Mark that end
+ * closed, wake anyone on the other end so they notice, and free the
+ * pipe if this was the second end to go.
+ */
+static
+int
+pipe_reclaim(struct vnode *v)
+{
+	struct pipe *p = v->vn_data;
+	bool isread = (v == &p->p_readvn);
+	bool destroy;
+
+	/* Clean up first: once we drop p_lock the pipe may be freed. */
+	vnode_cleanup(v);
+
+	spinlock_acquire(&p->p_lock);
+	if (isread) {
+		p->p_readclosed = true;
+		wchan_wakeall(p->p_writewchan, &p->p_lock);
+	}
+	else {
+		p->p_writeclosed = true;
+		wchan_wakeall(p->p_readwchan, &p->p_lock);
+	}
+	destroy = p->p_readclosed && p->p_writeclosed;
+	spinlock_release(&p->p_lock);
+
+	if (destroy) {
+		pipe_destroy(p);
+	}
+	return 0;
+}
+
+/*
+ * Called for read. Returns whatever is buffered, up to the size of the
+ * request, waiting only if there's nothing at all.
+ */
+static
+int
+pipe_read(struct vnode *v, struct uio *uio)
+{
+	struct pipe *p = v->vn_data;
+	unsigned head, tail, avail, off, len;
+	size_t resid;
+	int result = 0;
+
+	KASSERT(v == &p->p_readvn);
+	KASSERT(uio->uio_rw == UIO_READ);
+
+	if (uio->uio_resid == 0) {
+		return 0;
+	}
+
+	lock_acquire(p->p_readlock);
+
+	tail = p->p_tail;
+	head = pipe_waitdata(p, tail);
+	/* Don't look at the data until we've seen the index covering it */
+	membar_load_load();
+
+	avail = head - tail;
+	if (avail > uio->uio_resid) {
+		avail = uio->uio_resid;
+	}
+	while (avail > 0) {
+		/* At most two pieces: up to the end of the ring, then from 0 */
+		off = tail % PIPE_SIZE;
+		len = PIPE_SIZE - off;
+		if (len > avail) {
+			len = avail;
+		}
+		resid = uio->uio_resid;
+		result = uiomove(p->p_buf + off, len, uio);
+		tail += resid - uio->uio_resid;
+		avail -= resid - uio->uio_resid;
+		if (result) {
+			break;
+		}
+	}
+
+	if (tail != p->p_tail) {
+		/* Finish reading the data before handing the space back */
+		membar_any_store();
+		p->p_tail = tail;
+		pipe_wake(p, &p->p_writesleeping, p->p_writewchan);
+	}
+
+	lock_release(p->p_readlock);
+	return result;
+}
+
+/*
+ * Called for write. Waits for space as needed until the whole request
+ * is written.
+ */
+static
+int
+pipe_write(struct vnode *v, struct uio *uio)
+{
+	struct pipe *p = v->vn_data;
+	unsigned head, tail, space, off, len;
+	size_t resid;
+	int result = 0;
+
+	KASSERT(v == &p->p_writevn);
+	KASSERT(uio->uio_rw == UIO_WRITE);
+
+	lock_acquire(p->p_writelock);
+
+	head = p->p_head;
+	while (uio->uio_resid > 0) {
+		result = pipe_waitspace(p, head, &tail);
+		if (result) {
+			break;
+		}
+		/* Don't overwrite anything until the reader is done with it */
+		membar_any_store();
+
+		space = PIPE_SIZE - (head - tail);
+		if (space > uio->uio_resid) {
+			space = uio->uio_resid;
+		}
+		while (space > 0) {
+			off = head % PIPE_SIZE;
+			len = PIPE_SIZE - off;
+			if (len > space) {
+				len = space;
+			}
+			resid = uio->uio_resid;
+			result = uiomove(p->p_buf + off, len, uio);
+			head += resid - uio->uio_resid;
+			space -= resid - uio->uio_resid;
+			if (result) {
+				break;
+			}
+		}
+
+		/* Publish the data before the index that covers it */
+		membar_store_store();
+		p->p_head = head;
+		pipe_wake(p, &p->p_readsleeping, p->p_readwchan);
+
+		if (result) {
+			break;
+		}
+	}
+
+	lock_release(p->p_writelock);
+	return result;
+}
+
+/*
+ * Called for ioctl(). No ioctls.
+ */
+static
+int
+pipe_ioctl(struct vnode *v, int op, userptr_t data)
+{
+	(void)v;
+	(void)op;
+	(void)data;
+	return EINVAL;
+}
+
+/*
+ * Called for stat(). The size is the amount currently buffered.
+ */
+static
+int
+pipe_stat(struct vnode *v, struct stat *statbuf)
+{
+	struct pipe *p = v->vn_data;
+
+	bzero(statbuf, sizeof(struct stat));
+	statbuf->st_mode = S_IFIFO | 0600;
+	statbuf->st_size = p->p_head - p->p_tail;
+	statbuf->st_blksize = PIPE_SIZE;
+	statbuf->st_nlink = 1;
+	return 0;
+}
+
+/*
+ * Return the type.
+ */
+static
+int
+pipe_gettype(struct vnode *v, mode_t *ret)
+{
+	(void)v;
+	*ret = S_IFIFO;
+	return 0;
+}
+
+/*
+ * Pipes can't seek.
+ */
+static
+bool
+pipe_isseekable(struct vnode *v)
+{
+	(void)v;
+	return false;
+}
+
+/*
+ * For fsync() and ftruncate() - not meaningful on a pipe.
+ */
+static
+int
+pipe_fsync(struct vnode *v)
+{
+	(void)v;
+	return EINVAL;
+}
+
+static
+int
+pipe_truncate(struct vnode *v, off_t len)
+{
+	(void)v;
+	(void)len;
+	return EINVAL;
+}
+
+/*
+ * Function table for pipe vnodes.
+ */
+static const struct vnode_ops pipe_vnode_ops = {
+	.vop_magic = VOP_MAGIC,
+
+	.vop_eachopen = pipe_eachopen,
+	.vop_reclaim = pipe_reclaim,
+	.vop_read = pipe_read,
+	.vop_readlink = vopfail_uio_inval,
+	.vop_getdirentry = vopfail_uio_notdir,
+	.vop_write = pipe_write,
+	.vop_ioctl = pipe_ioctl,
+	.vop_stat = pipe_stat,
+	.vop_gettype = pipe_gettype,
+	.vop_isseekable = pipe_isseekable,
+	.vop_fsync = pipe_fsync,
+	.vop_mmap = vopfail_mmap_nosys,
+	.vop_truncate = pipe_truncate,
+	.vop_namefile = vopfail_uio_nosys,
+	.vop_creat = vopfail_creat_notdir,
+	.vop_symlink = vopfail_symlink_notdir,
+	.vop_mkdir = vopfail_mkdir_notdir,
+	.vop_link = vopfail_link_notdir,
+	.vop_remove = vopfail_string_notdir,
+	.vop_rmdir = vopfail_string_notdir,
+	.vop_rename = vopfail_rename_notdir,
+	.vop_lookup = vopfail_lookup_notdir,
+	.vop_lookparent = vopfail_lookparent_notdir,
+};
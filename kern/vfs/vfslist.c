@@ -110,6 +110,7 @@ vfs_bootstrap(void)
 	vfs_biglock_depth = 0;
 
 	devnull_create();
+	devstat_create();
 	semfs_bootstrap();
 }
 
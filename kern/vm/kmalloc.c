@@ -31,6 +31,7 @@
 #include <lib.h>
 #include <spinlock.h>
 #include <vm.h>
+#include <counters.h>
 
 /*
  * Kernel malloc.
@@ -167,7 +168,8 @@ struct pageref {
  * OS/161 performance and scalability aren't super-critical.
  */
 
-static struct spinlock kmalloc_spinlock = SPINLOCK_INITIALIZER;
+static struct spinlock kmalloc_spinlock =
+	SPINLOCK_INITIALIZER_KIND("kmalloc_spinlock", SPINLOCK_TICKET);
 
 ////////////////////////////////////////
 
@@ -1177,6 +1179,8 @@ kmalloc(size_t sz)
 #endif /* __GNUC__ */
 #endif /* LABELS */
 
+	counter_inc(CTR_KMALLOC);
+
 	checksz = sz + GUARD_OVERHEAD + LABEL_OVERHEAD;
 	if (checksz >= LARGEST_SUBPAGE_SIZE) {
 		unsigned long npages;
@@ -1211,7 +1215,9 @@ kfree(void *ptr)
 	 */
 	if (ptr == NULL) {
 		return;
-	} else if (subpage_kfree(ptr)) {
+	}
+	counter_inc(CTR_KFREE);
+	if (subpage_kfree(ptr)) {
 		KASSERT((vaddr_t)ptr%PAGE_SIZE==0);
 		free_kpages((vaddr_t)ptr);
 	}
@@ -36,6 +36,13 @@
  */
 
 
+/*
+ * Amount to ask the kernel to copy per call. Big enough that the
+ * system call overhead disappears; the kernel breaks it into
+ * block-sized pieces itself.
+ */
+#define COPYSIZE (64*1024)
+
 /* Copy one file to another. */
 static
 void
@@ -43,8 +50,7 @@ copy(const char *from, const char *to)
 {
 	int fromfd;
 	int tofd;
-	char buf[1024];
-	int len, wr, wrtot;
+	ssize_t len;
 
 	/*
 	 * Open the files, and give up if they won't open
@@ -59,30 +65,18 @@ copy(const char *from, const char *to)
 	}
 
 	/*
-	 * As long as we get more than zero bytes, we haven't hit EOF.
-	 * Zero means EOF. Less than zero means an error occurred.
-	 * We may read less than we asked for, though, in various cases
-	 * for various reasons.
+	 * Have the kernel move the data directly from one file to the
+	 * other, advancing both seek positions, so it never has to be
+	 * copied out to us and back in again. As long as we get more
+	 * than zero bytes, we haven't hit EOF. Zero means EOF. Less
+	 * than zero means an error occurred on one file or the other.
 	 */
-	while ((len = read(fromfd, buf, sizeof(buf)))>0) {
-		/*
-		 * Likewise, we may actually write less than we attempted
-		 * to. So loop until we're done.
-		 */
-		wrtot = 0;
-		while (wrtot < len) {
-			wr = write(tofd, buf+wrtot, len-wrtot);
-			if (wr<0) {
-				err(1, "%s", to);
-			}
-			wrtot += wr;
-		}
+	while ((len = copy_file_range(fromfd, NULL, tofd, NULL,
+				      COPYSIZE, 0))>0) {
+		/* nothing */
 	}
-	/*
-	 * If we got a read error, print it and exit.
-	 */
 	if (len<0) {
-		err(1, "%s", from);
+		err(1, "%s to %s", from, to);
 	}
 
 	if (close(fromfd) < 0) {
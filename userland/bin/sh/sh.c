@@ -58,6 +58,9 @@
 /* avoid making this unreasonably large; causes problems under dumbvm */
 #define CMDLINE_MAX 4096
 
+/* maximum number of commands joined with | */
+#define MAXSTAGES 16
+
 /* struct to (portably) hold exit info */
 struct exitinfo {
 	unsigned val:8,
@@ -75,21 +78,21 @@ static pid_t bgpids[MAXBG];
 
 /*
  * can_bg
- * just checks for an open slot.
+ * just checks for enough open slots (one per process in the job).
  */
 static
 int
-can_bg(void)
+can_bg(int nprocs)
 {
-	int i;
+	int i, avail = 0;
 
 	for (i = 0; i < MAXBG; i++) {
 		if (bgpids[i] == 0) {
-			return 1;
+			avail++;
 		}
 	}
 
-	return 0;
+	return avail >= nprocs;
 }
 
 /*
@@ -355,21 +358,80 @@ static struct {
 	{ NULL, NULL }
 };
 
+/*
+ * runstage
+ * forks one command of a pipeline. the child reads from infd if it's not -1
+ * and writes to outfd if it's not -1, in place of stdin and stdout; closefd,
+ * if not -1, is the parent's end of the next pipe, which the child must not
+ * hold open or the next stage would never see EOF. returns the pid, or -1.
+ */
+static
+pid_t
+runstage(char **args, int infd, int outfd, int closefd)
+{
+	pid_t pid;
+
+	pid = fork();
+	switch (pid) {
+		case -1:
+			/* error */
+			warn("fork");
+			return -1;
+		case 0:
+			/* child */
+			if (closefd >= 0) {
+				close(closefd);
+			}
+			if (infd >= 0) {
+				if (dup2(infd, STDIN_FILENO) < 0) {
+					warn("dup2");
+					_exit(1);
+				}
+				close(infd);
+			}
+			if (outfd >= 0) {
+				if (dup2(outfd, STDOUT_FILENO) < 0) {
+					warn("dup2");
+					_exit(1);
+				}
+				close(outfd);
+			}
+			execvp(args[0], args);
+			warn("%s", args[0]);
+			/*
+			 * Use _exit() instead of exit() in the child
+			 * process to avoid calling atexit() functions,
+			 * which would cause hostcompat (if present) to
+			 * reset the tty state and mess up our input
+			 * handling.
+			 */
+			_exit(1);
+		default:
+			break;
+	}
+	return pid;
+}
+
 /*
  * docommand
  * tokenizes the command line using strtok.  if there aren't any commands,
  * simply returns.  checks to see if it's a builtin, running it if it is.
- * otherwise, it's a standard command.  check for the '&', try to background
- * the job if possible, otherwise just run it and wait on it.
+ * otherwise, it's a standard command, or several joined into a pipeline
+ * with "|".  check for the '&', try to background the job if possible,
+ * otherwise just run it and wait on it.  all the commands in a pipeline
+ * run at once, each one's stdout connected to the next one's stdin; the
+ * exit status is that of the last one.
  */
 static
 void
 docommand(char *buf, struct exitinfo *ei)
 {
 	char *args[NARG_MAX + 1];
-	int nargs, i;
+	char **stages[MAXSTAGES];
+	pid_t pids[MAXSTAGES];
+	int nargs, nstages, npids, i;
+	int pipefds[2], infd;
 	char *s;
-	pid_t pid;
 	int status;
 	int bg=0;
 	time_t startsecs, endsecs;
@@ -394,10 +456,16 @@ docommand(char *buf, struct exitinfo *ei)
 		return;
 	}
 
-	for (i=0; builtins[i].name; i++) {
-		if (!strcmp(builtins[i].name, args[0])) {
-			builtins[i].func(nargs, args, ei);
-			return;
+	/* builtins run in the shell, so they can't be part of a pipeline */
+	for (i=0; i<nargs && strcmp(args[i], "|") != 0; i++) {
+		/* nothing */
+	}
+	if (i == nargs) {
+		for (i=0; builtins[i].name; i++) {
+			if (!strcmp(builtins[i].name, args[0])) {
+				builtins[i].func(nargs, args, ei);
+				return;
+			}
 		}
 	}
 
@@ -405,60 +473,101 @@ docommand(char *buf, struct exitinfo *ei)
 
 	if (nargs > 0 && !strcmp(args[nargs-1], "&")) {
 		/* background */
-		if (!can_bg()) {
-			printf("%s: Too many background jobs; wait for "
-			       "some to finish before starting more\n",
-			       args[0]);
-			exitinfo_exit(ei, 1);
-			return;
-		}
 		nargs--;
 		args[nargs] = NULL;
 		bg = 1;
 	}
 
+	/* split into pipeline stages at each "|" */
+	nstages = 0;
+	stages[nstages++] = &args[0];
+	for (i=0; i<nargs; i++) {
+		if (strcmp(args[i], "|") != 0) {
+			continue;
+		}
+		if (nstages >= MAXSTAGES) {
+			printf("Too many commands in pipeline\n");
+			exitinfo_exit(ei, 1);
+			return;
+		}
+		args[i] = NULL;
+		stages[nstages++] = &args[i+1];
+	}
+	for (i=0; i<nstages; i++) {
+		if (stages[i][0] == NULL) {
+			printf("Missing command in pipeline\n");
+			exitinfo_exit(ei, 1);
+			return;
+		}
+	}
+
+	if (bg && !can_bg(nstages)) {
+		printf("%s: Too many background jobs; wait for "
+		       "some to finish before starting more\n",
+		       args[0]);
+		exitinfo_exit(ei, 1);
+		return;
+	}
+
 	if (timing) {
 		__time(&startsecs, &startnsecs);
 	}
 
-	pid = fork();
-	switch (pid) {
-		case -1:
-			/* error */
-			warn("fork");
+	/*
+	 * Start every stage before waiting for any, so they run
+	 * concurrently and a full pipe doesn't stall the job. We close
+	 * our copies of each pipe as soon as both of its ends have been
+	 * handed out, so the readers see EOF when the writers exit.
+	 */
+	exitinfo_exit(ei, 0);
+	infd = -1;
+	for (npids=0; npids<nstages; npids++) {
+		pipefds[0] = pipefds[1] = -1;
+		if (npids < nstages-1 && pipe(pipefds) < 0) {
+			warn("pipe");
+			exitinfo_exit(ei, 255);
+			break;
+		}
+		pids[npids] = runstage(stages[npids], infd, pipefds[1],
+				       pipefds[0]);
+		if (infd >= 0) {
+			close(infd);
+		}
+		if (pipefds[1] >= 0) {
+			close(pipefds[1]);
+		}
+		infd = pipefds[0];
+		if (pids[npids] < 0) {
 			exitinfo_exit(ei, 255);
-			return;
-		case 0:
-			/* child */
-			execvp(args[0], args);
-			warn("%s", args[0]);
-			/*
-			 * Use _exit() instead of exit() in the child
-			 * process to avoid calling atexit() functions,
-			 * which would cause hostcompat (if present) to
-			 * reset the tty state and mess up our input
-			 * handling.
-			 */
-			_exit(1);
-		default:
 			break;
+		}
+	}
+	if (infd >= 0) {
+		close(infd);
 	}
 
 	/* parent */
 	if (bg) {
-		/* background this command */
-		remember_bg(pid);
-		printf("[%d] %s ... &\n", pid, args[0]);
-		exitinfo_exit(ei, 0);
+		/* background this job */
+		for (i=0; i<npids; i++) {
+			remember_bg(pids[i]);
+			printf("[%d] %s ... &\n", pids[i], stages[i][0]);
+		}
+		if (npids == nstages) {
+			exitinfo_exit(ei, 0);
+		}
 		return;
 	}
 
-	if (waitpid(pid, &status, 0) < 0) {
-		warn("waitpid");
-		exitinfo_exit(ei, 255);
-	}
-	else {
-		readstatus(status, ei);
+	for (i=0; i<npids; i++) {
+		if (waitpid(pids[i], &status, 0) < 0) {
+			warn("waitpid");
+			exitinfo_exit(ei, 255);
+		}
+		else if (i == nstages-1) {
+			/* the job's status is the last command's */
+			readstatus(status, ei);
+		}
 	}
 
 	if (timing) {
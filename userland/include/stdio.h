@@ -50,6 +50,23 @@ int __vprintf(void (*sendfunc)(void *clientdata, const char *, size_t len),
 	      const char *fmt,
 	      __va_list ap);
 
+/*
+ * Buffered output to a file handle (for libc internal use only).
+ * __outbuf_send is suitable as a __vprintf sendfunc; small pieces
+ * collect in the buffer and larger ones go out together with it in
+ * one writev, so a whole line usually costs a single system call.
+ * Call __outbuf_flush when done.
+ */
+#define __OUTBUF_SIZE 128
+struct __outbuf {
+	int ob_fd;
+	size_t ob_len;
+	char ob_buf[__OUTBUF_SIZE];
+};
+void __outbuf_init(struct __outbuf *ob, int fd);
+void __outbuf_send(void *ob, const char *data, size_t len);
+void __outbuf_flush(struct __outbuf *ob);
+
 /* Printf calls for user programs */
 int printf(const char *fmt, ...);
 int vprintf(const char *fmt, __va_list ap);
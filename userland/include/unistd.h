@@ -39,12 +39,14 @@
  * about the kern/ headers.
  */
 #include <kern/fcntl.h>
+#include <kern/iovec.h>
 #include <kern/ioctl.h>
 #include <kern/reboot.h>
 #include <kern/seek.h>
 #include <kern/time.h>
 #include <kern/unistd.h>
 #include <kern/wait.h>
+#include <kern/resource.h>	/* needs struct timeval from kern/time.h */
 
 
 /*
@@ -145,9 +147,21 @@ ssize_t getdirentry(int filehandle, char *buf, size_t buflen);
 int symlink(const char *target, const char *linkname);
 ssize_t readlink(const char *path, char *buf, size_t buflen);
 int dup2(int filehandle, int newhandle);
+ssize_t pread(int filehandle, void *buf, size_t size, off_t pos);
+ssize_t pwrite(int filehandle, const void *buf, size_t size, off_t pos);
+ssize_t readv(int filehandle, const struct iovec *iov, int iovcnt);
+ssize_t writev(int filehandle, const struct iovec *iov, int iovcnt);
+ssize_t copy_file_range(int infile, off_t *inpos, int outfile, off_t *outpos,
+			size_t len, unsigned flags);
 int pipe(int filehandles[2]);
 int __time(time_t *seconds, unsigned long *nanoseconds);
+int nanosleep(const struct timespec *req, struct timespec *rem);
 ssize_t __getcwd(char *buf, size_t buflen);
+int setpriority(int which, pid_t who, int prio);
+int getpriority(int which, pid_t who);
+int getrusage(int who, struct rusage *usage);
+int futex_wait(volatile int *addr, int expected, const struct timespec *timeout);
+int futex_wake(volatile int *addr, int n);
 /* stat - see sys/stat.h */
 /* lstat - see sys/stat.h */
 
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Buffered output to a file handle, for printf and friends.
+ *
+ * Output is not kept across calls: each user of this flushes before
+ * returning, so it never reorders with plain write() calls. It only
+ * batches the pieces of one call (e.g. the fragments __vprintf hands
+ * us) into as few system calls as possible.
+ */
+
+void
+__outbuf_init(struct __outbuf *ob, int fd)
+{
+	ob->ob_fd = fd;
+	ob->ob_len = 0;
+}
+
+void
+__outbuf_send(void *data_ob, const char *data, size_t len)
+{
+	struct __outbuf *ob = data_ob;
+	struct iovec iov[2];
+
+	if (len <= sizeof(ob->ob_buf) - ob->ob_len) {
+		memcpy(ob->ob_buf + ob->ob_len, data, len);
+		ob->ob_len += len;
+		return;
+	}
+
+	/*
+	 * Doesn't fit; send what we have and the new piece together
+	 * rather than copying the new piece through the buffer.
+	 */
+	if (ob->ob_len == 0) {
+		write(ob->ob_fd, data, len);
+		return;
+	}
+	iov[0].iov_base = ob->ob_buf;
+	iov[0].iov_len = ob->ob_len;
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len = len;
+	writev(ob->ob_fd, iov, 2);
+	ob->ob_len = 0;
+}
+
+void
+__outbuf_flush(struct __outbuf *ob)
+{
+	if (ob->ob_len > 0) {
+		write(ob->ob_fd, ob->ob_buf, ob->ob_len);
+		ob->ob_len = 0;
+	}
+}
@@ -29,27 +29,13 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <unistd.h>
 
 /*
  * printf - C standard I/O function.
  */
 
 
-/*
- * Function passed to __vprintf to do the actual output.
- */
-static
-void
-__printf_send(void *mydata, const char *data, size_t len)
-{
-	unsigned i;
-	(void)mydata;  /* not needed */
-
-	for (i=0; i<len; i++) {
-		putchar(data[i]);
-	}
-}
-
 /* printf: hand off to vprintf */
 int
 printf(const char *fmt, ...)
@@ -62,9 +48,19 @@ printf(const char *fmt, ...)
 	return chars;
 }
 
-/* vprintf: call __vprintf to do the work. */
+/*
+ * vprintf: call __vprintf to do the work, collecting the output in an
+ * __outbuf so it goes out in a few system calls rather than one
+ * per character.
+ */
 int
 vprintf(const char *fmt, va_list ap)
 {
-	return __vprintf(__printf_send, NULL, fmt, ap);
+	struct __outbuf ob;
+	int chars;
+
+	__outbuf_init(&ob, STDOUT_FILENO);
+	chars = __vprintf(__outbuf_send, &ob, fmt, ap);
+	__outbuf_flush(&ob);
+	return chars;
 }
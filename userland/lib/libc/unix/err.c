@@ -45,26 +45,13 @@
 extern char **__argv;
 
 /*
- * Routine to print error message text to stderr.
+ * Shortcut to send a null-terminated string through the output buffer.
  */
 static
 void
-__senderr(void *junk, const char *data, size_t len)
+__senderrstr(struct __outbuf *ob, const char *str)
 {
-	(void)junk;  /* not needed or used */
-
-	write(STDERR_FILENO, data, len);
-}
-
-/*
- * Shortcut to call __senderr on a null-terminated string.
- * (__senderr is set up to be called by __vprintf.)
- */
-static
-void
-__senderrstr(const char *str)
-{
-	__senderr(NULL, str, strlen(str));
+	__outbuf_send(ob, str, strlen(str));
 }
 
 /*
@@ -74,6 +61,7 @@ static
 void
 __printerr(int use_errno, const char *fmt, va_list ap)
 {
+	struct __outbuf ob;
 	const char *errmsg;
 	const char *prog;
 
@@ -98,21 +86,29 @@ __printerr(int use_errno, const char *fmt, va_list ap)
 		prog = "(program name unknown)";
 	}
 
+	/*
+	 * Collect the whole message in an output buffer so it goes to
+	 * stderr in as few writes as possible, not interleaved piecewise with
+	 * other processes' output.
+	 */
+	__outbuf_init(&ob, STDERR_FILENO);
+
 	/* print the program name */
-	__senderrstr(prog);
-	__senderrstr(": ");
+	__senderrstr(&ob, prog);
+	__senderrstr(&ob, ": ");
 
 	/* process the printf format and args */
-	__vprintf(__senderr, NULL, fmt, ap);
+	__vprintf(__outbuf_send, &ob, fmt, ap);
 
 	/* if we're using errno, print the error string from above. */
 	if (use_errno) {
-		__senderrstr(": ");
-		__senderrstr(errmsg);
+		__senderrstr(&ob, ": ");
+		__senderrstr(&ob, errmsg);
 	}
 
 	/* and always add a newline. */
-	__senderrstr("\n");
+	__senderrstr(&ob, "\n");
+	__outbuf_flush(&ob);
 }
 
 /*
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * tracedump - print a kernel event trace as a timeline.
+ * Usage: tracedump tracefile
+ *
+ * Reads a file written by the kernel menu's "trace save" command (see
+ * <kern/trace.h>), merges the per-cpu event streams by timestamp, and
+ * prints one line per event with times relative to the first event.
+ *
+ * Also builds for the host system (in hostbin); the file's byte order
+ * is worked out from the magic number, so it doesn't matter which end
+ * the file is read from.
+ */
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <err.h>
+
+#include "kern/trace.h"
+
+#ifdef HOST
+#include "hostcompat.h"
+
+extern const char *hostcompat_progname;
+#endif
+
+/* An event plus its position in the file, to keep the sort stable. */
+struct tevent {
+	struct trace_event ev;
+	unsigned seq;
+};
+
+static bool doswap;
+
+static
+uint32_t
+swap32(uint32_t x)
+{
+	if (!doswap) {
+		return x;
+	}
+	return ((x & 0xff) << 24) | ((x & 0xff00) << 8) |
+		((x >> 8) & 0xff00) | (x >> 24);
+}
+
+static
+uint16_t
+swap16(uint16_t x)
+{
+	if (!doswap) {
+		return x;
+	}
+	return (uint16_t)((x << 8) | (x >> 8));
+}
+
+static
+void
+doread(int fd, void *buf, size_t len, const char *file)
+{
+	ssize_t r;
+	size_t done = 0;
+
+	while (done < len) {
+		r = read(fd, (char *)buf + done, len - done);
+		if (r < 0) {
+			err(1, "%s: read", file);
+		}
+		if (r == 0) {
+			errx(1, "%s: unexpected end of file", file);
+		}
+		done += r;
+	}
+}
+
+static
+int
+tevent_cmp(const void *av, const void *bv)
+{
+	const struct tevent *a = av;
+	const struct tevent *b = bv;
+
+	if (a->ev.te_sec != b->ev.te_sec) {
+		return a->ev.te_sec < b->ev.te_sec ? -1 : 1;
+	}
+	if (a->ev.te_nsec != b->ev.te_nsec) {
+		return a->ev.te_nsec < b->ev.te_nsec ? -1 : 1;
+	}
+	if (a->seq != b->seq) {
+		return a->seq < b->seq ? -1 : 1;
+	}
+	return 0;
+}
+
+static
+const char *
+statename(uint32_t state)
+{
+	/* threadstate_t */
+	switch (state) {
+	    case 0: return "run";
+	    case 1: return "ready";
+	    case 2: return "sleep";
+	    case 3: return "zombie";
+	}
+	return "?";
+}
+
+static
+void
+printevent(const struct trace_event *ev)
+{
+	const uint32_t *a = ev->te_arg;
+
+	switch (ev->te_type) {
+	    case TRACE_SWITCH:
+		printf("switch     pid %u -> pid %u (%s)\n",
+		       a[0], a[1], statename(a[2]));
+		break;
+	    case TRACE_SYSCALL:
+		printf("syscall    %u pid %u\n", a[0], a[1]);
+		break;
+	    case TRACE_SYSRET:
+		if (a[1] != 0) {
+			printf("sysret     %u error %u\n", a[0], a[1]);
+		}
+		else {
+			printf("sysret     %u = %d\n", a[0], (int)a[2]);
+		}
+		break;
+	    case TRACE_VMFAULT:
+		printf("vmfault    type %u addr 0x%08x pid %u\n",
+		       a[0], a[1], a[2]);
+		break;
+	    case TRACE_LHD_START:
+		printf("disk-start sector %u count %u %s\n",
+		       a[0], a[1], a[2] ? "write" : "read");
+		break;
+	    case TRACE_LHD_DONE:
+		printf("disk-done  sector %u count %u error %u\n",
+		       a[0], a[1], a[2]);
+		break;
+	    case TRACE_SFS_READ:
+	    case TRACE_SFS_WRITE:
+		printf("%s  ino %u offset %u len %u\n",
+		       ev->te_type == TRACE_SFS_READ ? "sfs-read " :
+		       "sfs-write", a[0], a[1], a[2]);
+		break;
+	    default:
+		printf("type %u    %u %u %u\n", ev->te_type, a[0], a[1], a[2]);
+		break;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct trace_filehdr hdr;
+	struct tevent *evs;
+	uint32_t base_sec, base_nsec, sec, nsec;
+	unsigned i, j;
+	int fd;
+
+#ifdef HOST
+	/* As in dumpsfs, skip hostcompat_init so the output can be piped */
+	hostcompat_progname = argv[0];
+#endif
+
+	if (argc != 2) {
+		errx(1, "Usage: tracedump tracefile");
+	}
+
+	fd = open(argv[1], O_RDONLY);
+	if (fd < 0) {
+		err(1, "%s", argv[1]);
+	}
+
+	doread(fd, &hdr, sizeof(hdr), argv[1]);
+	if (hdr.th_magic != TRACE_MAGIC) {
+		doswap = true;
+		if (swap32(hdr.th_magic) != TRACE_MAGIC) {
+			errx(1, "%s: not a trace file", argv[1]);
+		}
+	}
+	hdr.th_ncpus = swap32(hdr.th_ncpus);
+	hdr.th_nevents = swap32(hdr.th_nevents);
+	hdr.th_lost = swap32(hdr.th_lost);
+
+	printf("%u cpus, %u events, %u lost\n",
+	       hdr.th_ncpus, hdr.th_nevents, hdr.th_lost);
+	if (hdr.th_nevents == 0) {
+		close(fd);
+		return 0;
+	}
+
+	evs = malloc(hdr.th_nevents * sizeof(*evs));
+	if (evs == NULL) {
+		errx(1, "Out of memory");
+	}
+	for (i=0; i<hdr.th_nevents; i++) {
+		doread(fd, &evs[i].ev, sizeof(evs[i].ev), argv[1]);
+		evs[i].ev.te_sec = swap32(evs[i].ev.te_sec);
+		evs[i].ev.te_nsec = swap32(evs[i].ev.te_nsec);
+		evs[i].ev.te_type = swap16(evs[i].ev.te_type);
+		evs[i].ev.te_cpu = swap16(evs[i].ev.te_cpu);
+		for (j=0; j<3; j++) {
+			evs[i].ev.te_arg[j] = swap32(evs[i].ev.te_arg[j]);
+		}
+		evs[i].seq = i;
+	}
+	close(fd);
+
+	qsort(evs, hdr.th_nevents, sizeof(*evs), tevent_cmp);
+
+	base_sec = evs[0].ev.te_sec;
+	base_nsec = evs[0].ev.te_nsec;
+	for (i=0; i<hdr.th_nevents; i++) {
+		sec = evs[i].ev.te_sec - base_sec;
+		nsec = evs[i].ev.te_nsec;
+		if (nsec < base_nsec) {
+			sec--;
+			nsec += 1000000000;
+		}
+		nsec -= base_nsec;
+		printf("%4u.%09u cpu%-2u ", sec, nsec, evs[i].ev.te_cpu);
+		printevent(&evs[i].ev);
+	}
+
+	free(evs);
+	return 0;
+}
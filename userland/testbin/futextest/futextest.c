@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * futextest - exercise futex_wait and futex_wake.
+ *
+ * Without user threads there is nobody in our address space to wake
+ * us, so this checks the paths that don't need a second thread: value
+ * mismatch, timeouts, waking with no waiters, bad arguments, and that
+ * a forked child (different address space, same virtual address)
+ * can't wake the parent.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <err.h>
+
+static volatile int word;
+static int failures;
+
+static
+void
+expect(int result, int expected_errno, const char *what)
+{
+	if (expected_errno == 0) {
+		if (result != 0) {
+			warn("%s: FAILED", what);
+			failures++;
+			return;
+		}
+	}
+	else if (result != -1 || errno != expected_errno) {
+		warnx("%s: FAILED (got %d, errno %d; expected errno %d)",
+		      what, result, result == -1 ? errno : 0, expected_errno);
+		failures++;
+		return;
+	}
+	printf("%s: passed\n", what);
+}
+
+int
+main(void)
+{
+	struct timespec ts;
+	pid_t pid;
+	int status, result;
+
+	word = 1;
+
+	result = futex_wait(&word, 0, NULL);
+	expect(result, EAGAIN, "wait with wrong value");
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 0;
+	result = futex_wait(&word, 1, &ts);
+	expect(result, ETIMEDOUT, "wait with zero timeout");
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 100000000;
+	result = futex_wait(&word, 1, &ts);
+	expect(result, ETIMEDOUT, "wait with 100ms timeout");
+
+	ts.tv_nsec = 1000000000;
+	result = futex_wait(&word, 1, &ts);
+	expect(result, EINVAL, "wait with bad timeout");
+
+	result = futex_wait((volatile int *)((char *)&word + 1), 1, NULL);
+	expect(result, EINVAL, "wait on misaligned address");
+
+	result = futex_wait(NULL, 1, NULL);
+	expect(result, EFAULT, "wait on NULL");
+
+	result = futex_wake(&word, 1);
+	if (result != 0) {
+		warnx("wake with no waiters: FAILED (woke %d)", result);
+		failures++;
+	}
+	else {
+		printf("wake with no waiters: passed\n");
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		err(1, "fork");
+	}
+	if (pid == 0) {
+		/* Keep waking "our" word while the parent waits on its own. */
+		int i;
+
+		for (i=0; i<20; i++) {
+			futex_wake(&word, 1);
+			ts.tv_sec = 0;
+			ts.tv_nsec = 10000000;
+			nanosleep(&ts, NULL);
+		}
+		_exit(0);
+	}
+	ts.tv_sec = 0;
+	ts.tv_nsec = 300000000;
+	result = futex_wait(&word, 1, &ts);
+	expect(result, ETIMEDOUT, "wake from another address space");
+	if (waitpid(pid, &status, 0) < 0) {
+		err(1, "waitpid");
+	}
+
+	if (failures) {
+		errx(1, "%d test(s) failed", failures);
+	}
+	printf("futextest done.\n");
+	return 0;
+}
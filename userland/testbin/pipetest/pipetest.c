@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * pipetest - exercise pipe.
+ *
+ * A forked child writes a known byte pattern, several times the size
+ * of the kernel's pipe buffer, in odd-sized pieces so the ring wraps
+ * in awkward places; the parent reads it back in differently sized
+ * pieces and checks it, then checks that it sees EOF once the child
+ * exits. Finally, writing to a pipe with no reader must fail with
+ * EPIPE, and neither end may seek.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <err.h>
+
+#define TOTAL (64*1024 + 17)
+#define WCHUNK 1000
+#define RCHUNK 777
+
+static
+char
+pattern(unsigned pos)
+{
+	return (char)(pos * 31 + (pos >> 8));
+}
+
+static
+void
+writer(int fd)
+{
+	char buf[WCHUNK];
+	unsigned pos = 0, len, i;
+	ssize_t r;
+
+	while (pos < TOTAL) {
+		len = TOTAL - pos;
+		if (len > WCHUNK) {
+			len = WCHUNK;
+		}
+		for (i=0; i<len; i++) {
+			buf[i] = pattern(pos + i);
+		}
+		r = write(fd, buf, len);
+		if (r < 0) {
+			err(1, "child: write");
+		}
+		if ((unsigned)r != len) {
+			errx(1, "child: short write %ld of %u", (long)r, len);
+		}
+		pos += len;
+	}
+}
+
+static
+int
+reader(int fd)
+{
+	char buf[RCHUNK];
+	unsigned pos = 0, i;
+	ssize_t r;
+
+	while ((r = read(fd, buf, sizeof(buf))) > 0) {
+		for (i=0; i<(unsigned)r; i++) {
+			if (buf[i] != pattern(pos + i)) {
+				warnx("wrong data at offset %u", pos + i);
+				return 1;
+			}
+		}
+		pos += r;
+	}
+	if (r < 0) {
+		warn("read");
+		return 1;
+	}
+	if (pos != TOTAL) {
+		warnx("EOF after %u bytes, expected %u", pos, TOTAL);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main(void)
+{
+	int fds[2];
+	int status, failures = 0;
+	pid_t pid;
+	char c = 0;
+
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		err(1, "fork");
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		writer(fds[1]);
+		_exit(0);
+	}
+	close(fds[1]);
+	failures += reader(fds[0]);
+	close(fds[0]);
+	if (waitpid(pid, &status, 0) < 0) {
+		err(1, "waitpid");
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		warnx("writer failed");
+		failures++;
+	}
+
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+	if (lseek(fds[0], 0, SEEK_SET) >= 0 || errno != ESPIPE) {
+		warnx("lseek on pipe: expected ESPIPE");
+		failures++;
+	}
+	close(fds[0]);
+	if (write(fds[1], &c, 1) >= 0 || errno != EPIPE) {
+		warnx("write with no reader: expected EPIPE");
+		failures++;
+	}
+	close(fds[1]);
+
+	if (failures) {
+		errx(1, "%d failures", failures);
+	}
+	printf("pipetest: passed\n");
+	return 0;
+}
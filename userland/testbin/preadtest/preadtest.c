@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2025
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * preadtest - exercise pread and pwrite.
+ *
+ * The parent fills a file with pwrite, in reverse block order so every
+ * write lands at an explicit offset, then forks several readers that
+ * share the one open file. Each reader preads scattered blocks and
+ * checks their contents. Since pread never touches the shared seek
+ * position, the readers can't disturb each other, and the seek
+ * position is still 0 afterwards.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <err.h>
+
+#define FILENAME "preadtest.dat"
+#define BLOCKSIZE 512
+#define NBLOCKS 32
+#define NREADERS 4
+#define NREADS 200
+
+static
+void
+fillblock(char *buf, unsigned block)
+{
+	unsigned i;
+
+	for (i = 0; i < BLOCKSIZE; i++) {
+		buf[i] = (char)(block * 7 + i);
+	}
+}
+
+static
+int
+reader(int fd, unsigned seed)
+{
+	char buf[BLOCKSIZE], want[BLOCKSIZE];
+	unsigned block;
+	ssize_t r;
+	int i;
+
+	for (i = 0; i < NREADS; i++) {
+		seed = seed * 1103515245 + 12345;
+		block = (seed >> 16) % NBLOCKS;
+		r = pread(fd, buf, sizeof(buf), (off_t)block * BLOCKSIZE);
+		if (r < 0) {
+			warn("pread of block %u", block);
+			return 1;
+		}
+		if (r != BLOCKSIZE) {
+			warnx("pread of block %u: short count %ld", block,
+			      (long)r);
+			return 1;
+		}
+		fillblock(want, block);
+		if (memcmp(buf, want, BLOCKSIZE) != 0) {
+			warnx("pread of block %u: wrong data", block);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int
+main(void)
+{
+	char buf[BLOCKSIZE];
+	pid_t pids[NREADERS];
+	int fd, i, status, failures = 0;
+	ssize_t r;
+	off_t pos;
+
+	fd = open(FILENAME, O_RDWR|O_CREAT|O_TRUNC, 0664);
+	if (fd < 0) {
+		err(1, "%s", FILENAME);
+	}
+
+	for (i = NBLOCKS - 1; i >= 0; i--) {
+		fillblock(buf, i);
+		r = pwrite(fd, buf, sizeof(buf), (off_t)i * BLOCKSIZE);
+		if (r != BLOCKSIZE) {
+			err(1, "pwrite of block %d", i);
+		}
+	}
+
+	if (pread(fd, buf, sizeof(buf), -1) >= 0 || errno != EINVAL) {
+		warnx("pread at negative offset: expected EINVAL");
+		failures++;
+	}
+	if (pread(STDIN_FILENO, buf, sizeof(buf), 0) >= 0 || errno != ESPIPE) {
+		warnx("pread on console: expected ESPIPE");
+		failures++;
+	}
+
+	for (i = 0; i < NREADERS; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			err(1, "fork");
+		}
+		if (pids[i] == 0) {
+			_exit(reader(fd, i + 1));
+		}
+	}
+	for (i = 0; i < NREADERS; i++) {
+		if (waitpid(pids[i], &status, 0) < 0) {
+			err(1, "waitpid");
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			warnx("reader %d failed", i);
+			failures++;
+		}
+	}
+
+	pos = lseek(fd, 0, SEEK_CUR);
+	if (pos != 0) {
+		warnx("seek position moved to %ld", (long)pos);
+		failures++;
+	}
+
+	close(fd);
+	remove(FILENAME);
+
+	if (failures) {
+		errx(1, "%d failures", failures);
+	}
+	printf("preadtest: passed\n");
+	return 0;
+}
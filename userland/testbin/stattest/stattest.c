@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * stattest - read the stat: device to EOF.
+ *
+ * stat: can't seek, but it serves its text by offset, so reads have
+ * to advance the open file's offset or a reader sees the first chunk
+ * forever. Read it in small pieces with read, and again in one go
+ * with copy_file_range, and check both reach EOF within a sane number
+ * of bytes and stay there.
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <err.h>
+
+#define DEVNAME "stat:"
+#define OUTNAME "stattest.out"
+
+/* Far more than stat: ever produces; reading past this means no EOF */
+#define MAXBYTES (256*1024)
+
+static
+int
+readall(void)
+{
+	char buf[37];	/* odd size, so reads don't line up with lines */
+	size_t total = 0;
+	ssize_t r;
+	int fd;
+
+	fd = open(DEVNAME, O_RDONLY);
+	if (fd < 0) {
+		err(1, "%s", DEVNAME);
+	}
+	while ((r = read(fd, buf, sizeof(buf))) > 0) {
+		total += r;
+		if (total > MAXBYTES) {
+			warnx("read: no EOF after %u bytes", (unsigned)total);
+			close(fd);
+			return 1;
+		}
+	}
+	if (r < 0) {
+		warn("read");
+		close(fd);
+		return 1;
+	}
+	if (total == 0) {
+		warnx("read: no data");
+		close(fd);
+		return 1;
+	}
+	if (read(fd, buf, sizeof(buf)) != 0) {
+		warnx("read: data after EOF");
+		close(fd);
+		return 1;
+	}
+	close(fd);
+	return 0;
+}
+
+static
+int
+copyall(void)
+{
+	size_t total = 0;
+	ssize_t r;
+	int fd, outfd;
+
+	fd = open(DEVNAME, O_RDONLY);
+	if (fd < 0) {
+		err(1, "%s", DEVNAME);
+	}
+	outfd = open(OUTNAME, O_WRONLY|O_CREAT|O_TRUNC, 0664);
+	if (outfd < 0) {
+		err(1, "%s", OUTNAME);
+	}
+	while ((r = copy_file_range(fd, NULL, outfd, NULL, 100, 0)) > 0) {
+		total += r;
+		if (total > MAXBYTES) {
+			break;
+		}
+	}
+	close(outfd);
+	close(fd);
+	remove(OUTNAME);
+
+	if (r < 0) {
+		warn("copy_file_range");
+		return 1;
+	}
+	if (total == 0 || total > MAXBYTES) {
+		warnx("copy_file_range: %u bytes before EOF", (unsigned)total);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main(void)
+{
+	int failures = 0;
+
+	failures += readall();
+	failures += copyall();
+	if (failures) {
+		errx(1, "%d failures", failures);
+	}
+	printf("stattest: passed\n");
+	return 0;
+}